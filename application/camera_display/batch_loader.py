@@ -0,0 +1,130 @@
+#!/usr/bin/env python3
+"""
+龙芯LS2K0300摄像头批量采集文件读取工具
+读取板卡 --batch-dir 写出的 .fbat 批文件（格式见 include/frame_batch.h）
+
+未压缩的批文件直接内存映射，帧数组不拷贝、不解析；
+压缩的批文件（--batch-compress）解压后按相同偏移读取。
+
+    from batch_loader import load_batch
+    frames, meta, header = load_batch("batch_000000.fbat")
+    # frames: (N, H, W) uint8，meta: 结构化数组（frame_index, reason, timestamp_us, ...）
+"""
+
+import sys
+import os
+import glob
+import zlib
+import numpy as np
+
+BATCH_MAGIC = 0x54414246
+BATCH_VERSION = 1
+BATCH_FLAG_ZLIB = 0x01
+HEADER_SIZE = 64
+
+# 与 BatchFileHeader 一致（64字节，小端）
+HEADER_DTYPE = np.dtype([
+    ('magic', '<u4'),
+    ('version', '<u2'),
+    ('header_size', '<u2'),
+    ('frame_count', '<u4'),
+    ('width', '<u2'),
+    ('height', '<u2'),
+    ('frame_stride', '<u4'),
+    ('meta_offset', '<u4'),
+    ('data_offset', '<u4'),
+    ('flags', '<u4'),
+    ('batch_sequence', '<u8'),
+    ('payload_size', '<u4'),
+    ('raw_size', '<u4'),
+    ('reserved', 'u1', 16),
+])
+
+# 与 BatchFrameMeta 一致（32字节）
+META_DTYPE = np.dtype([
+    ('frame_index', '<u4'),
+    ('reason', '<u4'),
+    ('timestamp_us', '<u8'),
+    ('motion_score', '<u4'),
+    ('luma_mean', 'u1'),
+    ('reserved', 'u1', 11),
+])
+
+REASON_NAMES = {0: '抽帧', 1: '事件前', 2: '事件'}
+
+
+def load_batch(path):
+    """
+    读取一个批文件
+    返回 (frames, meta, header)：frames 为 (N, H, W) uint8 数组
+    """
+    header = np.fromfile(path, dtype=HEADER_DTYPE, count=1)
+    if len(header) != 1 or header['magic'][0] != BATCH_MAGIC:
+        raise ValueError(f"{path}: 不是批文件")
+    header = header[0]
+    if header['version'] != BATCH_VERSION:
+        raise ValueError(f"{path}: 不支持的版本 {header['version']}")
+
+    if header['flags'] & BATCH_FLAG_ZLIB:
+        with open(path, 'rb') as f:
+            raw = f.read()
+        data = raw[:HEADER_SIZE] + zlib.decompress(raw[HEADER_SIZE:])
+        buf = np.frombuffer(data, dtype=np.uint8)
+    else:
+        buf = np.memmap(path, dtype=np.uint8, mode='r')
+
+    count = int(header['frame_count'])
+    width = int(header['width'])
+    height = int(header['height'])
+    stride = int(header['frame_stride'])
+    meta_offset = int(header['meta_offset'])
+    data_offset = int(header['data_offset'])
+
+    if len(buf) < data_offset + count * stride:
+        raise ValueError(f"{path}: 文件不完整")
+
+    meta = buf[meta_offset:meta_offset + count * META_DTYPE.itemsize].view(META_DTYPE)
+    # 每帧按 frame_stride 对齐存放，用步长视图跳过填充字节，不拷贝数据
+    frames = np.lib.stride_tricks.as_strided(
+        buf[data_offset:], shape=(count, height, width), strides=(stride, width, 1))
+    return frames, meta, header
+
+
+def list_batches(path):
+    """目录下所有完整的批文件（写入中的 .part 文件不包含在内），按序号排序"""
+    if os.path.isdir(path):
+        return sorted(glob.glob(os.path.join(path, 'batch_*.fbat')))
+    return [path]
+
+
+def main():
+    if len(sys.argv) < 2:
+        print("用法: python3 batch_loader.py <批文件目录或 .fbat 文件>")
+        print("示例: python3 batch_loader.py dataset/")
+        sys.exit(1)
+
+    files = list_batches(sys.argv[1])
+    if not files:
+        print(f"未找到批文件: {sys.argv[1]}")
+        sys.exit(1)
+
+    total_frames = 0
+    reason_counts = {}
+    for path in files:
+        frames, meta, header = load_batch(path)
+        compressed = "zlib" if header['flags'] & BATCH_FLAG_ZLIB else "未压缩"
+        print(f"{os.path.basename(path)}: 序号 {header['batch_sequence']}, "
+              f"{frames.shape[0]} 帧 {header['width']}x{header['height']}, "
+              f"{os.path.getsize(path) / 1024:.1f} KB ({compressed})")
+        total_frames += frames.shape[0]
+        for reason in meta['reason']:
+            reason_counts[int(reason)] = reason_counts.get(int(reason), 0) + 1
+
+    print("=" * 60)
+    print(f"共 {len(files)} 批, {total_frames} 帧")
+    for reason, count in sorted(reason_counts.items()):
+        print(f"  {REASON_NAMES.get(reason, reason)}: {count} 帧")
+
+
+if __name__ == "__main__":
+    main()
@@ -24,6 +24,31 @@ OPENCV_INCLUDE="-I${SYSROOT}/usr/include/opencv4"
 # 板卡上 OpenCV 的运行时路径
 OPENCV_RPATH="/home/root/opencv/lib"
 
+# 调试：统计采集线程每帧内存分配，稳态出现分配时程序以非0状态退出
+# 用法：ALLOC_TRACKING=1 ./build_simple.sh
+EXTRA_FLAGS=""
+if [ "${ALLOC_TRACKING}" = "1" ]; then
+    EXTRA_FLAGS="-DCAMERA_ALLOC_TRACKING"
+    echo "已启用内存分配检查（调试构建）"
+fi
+
+# LoongArch LSX 128位向量指令：变化检测等模块的可移植向量代码（simd_vec.h）直接编译为LSX指令
+# 需要支持 -mlsx 的工具链；未启用时向量代码拆分为64位通用寄存器运算
+# 用法：LSX=1 ./build_simple.sh
+if [ "${LSX}" = "1" ]; then
+    EXTRA_FLAGS="${EXTRA_FLAGS} -mlsx"
+    echo "已启用 LSX 向量指令"
+fi
+
+# 批量采集文件压缩（--batch-compress）需要目标系统提供 zlib
+# 用法：WITH_ZLIB=1 ./build_simple.sh
+EXTRA_LIBS=""
+if [ "${WITH_ZLIB}" = "1" ]; then
+    EXTRA_FLAGS="${EXTRA_FLAGS} -DHAVE_ZLIB"
+    EXTRA_LIBS="-lz"
+    echo "已启用 zlib 批文件压缩"
+fi
+
 echo "========================================"
 echo " 简化版龙芯交叉编译"
 echo "========================================"
@@ -43,44 +68,136 @@ ${CXX} -c ../src/main.cpp \
     -march=loongarch64 -mabi=lp64d \
     -I../include \
     ${OPENCV_INCLUDE} \
-    -O2 -Wall -std=c++11
+    -O2 -Wall -std=c++11 ${EXTRA_FLAGS}
 
 ${CXX} -c ../src/uvc_camera.cpp \
     --sysroot=${SYSROOT} \
     -march=loongarch64 -mabi=lp64d \
     -I../include \
     ${OPENCV_INCLUDE} \
-    -O2 -Wall -std=c++11
+    -O2 -Wall -std=c++11 ${EXTRA_FLAGS}
 
 ${CXX} -c ../src/ips200_display.cpp \
     --sysroot=${SYSROOT} \
     -march=loongarch64 -mabi=lp64d \
     -I../include \
     ${OPENCV_INCLUDE} \
-    -O2 -Wall -std=c++11
+    -O2 -Wall -std=c++11 ${EXTRA_FLAGS}
 
 ${CXX} -c ../src/network_stream.cpp \
     --sysroot=${SYSROOT} \
     -march=loongarch64 -mabi=lp64d \
     -I../include \
     ${OPENCV_INCLUDE} \
-    -O2 -Wall -std=c++11
+    -O2 -Wall -std=c++11 ${EXTRA_FLAGS}
+
+${CXX} -c ../src/rt_profile.cpp \
+    --sysroot=${SYSROOT} \
+    -march=loongarch64 -mabi=lp64d \
+    -I../include \
+    ${OPENCV_INCLUDE} \
+    -O2 -Wall -std=c++11 ${EXTRA_FLAGS}
+
+${CXX} -c ../src/motion_detect.cpp \
+    --sysroot=${SYSROOT} \
+    -march=loongarch64 -mabi=lp64d \
+    -I../include \
+    ${OPENCV_INCLUDE} \
+    -O2 -Wall -std=c++11 ${EXTRA_FLAGS}
+
+${CXX} -c ../src/http_stream.cpp \
+    --sysroot=${SYSROOT} \
+    -march=loongarch64 -mabi=lp64d \
+    -I../include \
+    ${OPENCV_INCLUDE} \
+    -O2 -Wall -std=c++11 ${EXTRA_FLAGS}
+
+${CXX} -c ../src/capture_supervisor.cpp \
+    --sysroot=${SYSROOT} \
+    -march=loongarch64 -mabi=lp64d \
+    -I../include \
+    ${OPENCV_INCLUDE} \
+    -O2 -Wall -std=c++11 ${EXTRA_FLAGS}
+
+${CXX} -c ../src/geo_remap.cpp \
+    --sysroot=${SYSROOT} \
+    -march=loongarch64 -mabi=lp64d \
+    -I../include \
+    ${OPENCV_INCLUDE} \
+    -O2 -Wall -std=c++11 ${EXTRA_FLAGS}
+
+${CXX} -c ../src/control_channel.cpp \
+    --sysroot=${SYSROOT} \
+    -march=loongarch64 -mabi=lp64d \
+    -I../include \
+    ${OPENCV_INCLUDE} \
+    -O2 -Wall -std=c++11 ${EXTRA_FLAGS}
+
+${CXX} -c ../src/auto_exposure.cpp \
+    --sysroot=${SYSROOT} \
+    -march=loongarch64 -mabi=lp64d \
+    -I../include \
+    ${OPENCV_INCLUDE} \
+    -O2 -Wall -std=c++11 ${EXTRA_FLAGS}
+
+${CXX} -c ../src/ring_logger.cpp \
+    --sysroot=${SYSROOT} \
+    -march=loongarch64 -mabi=lp64d \
+    -I../include \
+    ${OPENCV_INCLUDE} \
+    -O2 -Wall -std=c++11 ${EXTRA_FLAGS}
+
+${CXX} -c ../src/alloc_tracker.cpp \
+    --sysroot=${SYSROOT} \
+    -march=loongarch64 -mabi=lp64d \
+    -I../include \
+    ${OPENCV_INCLUDE} \
+    -O2 -Wall -std=c++11 ${EXTRA_FLAGS}
+
+${CXX} -c ../src/frame_batch.cpp \
+    --sysroot=${SYSROOT} \
+    -march=loongarch64 -mabi=lp64d \
+    -I../include \
+    ${OPENCV_INCLUDE} \
+    -O2 -Wall -std=c++11 ${EXTRA_FLAGS}
 
 # 链接
 echo "[2/3] 链接可执行文件..."
 
-${CXX} main.o uvc_camera.o ips200_display.o network_stream.o \
+${CXX} main.o uvc_camera.o ips200_display.o network_stream.o rt_profile.o motion_detect.o http_stream.o capture_supervisor.o geo_remap.o control_channel.o auto_exposure.o ring_logger.o alloc_tracker.o frame_batch.o \
     --sysroot=${SYSROOT} \
     -march=loongarch64 -mabi=lp64d \
     -L${SYSROOT}/usr/lib64 \
     -Wl,-rpath,${OPENCV_RPATH} \
     -lopencv_highgui -lopencv_videoio -lopencv_imgcodecs -lopencv_imgproc -lopencv_core \
-    -lpthread \
+    -lpthread ${EXTRA_LIBS} \
     -o camera_display_ips200
 
+# 内存分配自检程序（仅调试构建）：不需要摄像头，用合成图像驱动主循环每帧处理
+if [ "${ALLOC_TRACKING}" = "1" ]; then
+    ${CXX} -c ../src/alloc_selfcheck.cpp \
+        --sysroot=${SYSROOT} \
+        -march=loongarch64 -mabi=lp64d \
+        -I../include \
+        ${OPENCV_INCLUDE} \
+        -O2 -Wall -std=c++11 ${EXTRA_FLAGS}
+
+    ${CXX} alloc_selfcheck.o uvc_camera.o network_stream.o rt_profile.o motion_detect.o http_stream.o geo_remap.o control_channel.o auto_exposure.o ring_logger.o alloc_tracker.o frame_batch.o \
+        --sysroot=${SYSROOT} \
+        -march=loongarch64 -mabi=lp64d \
+        -L${SYSROOT}/usr/lib64 \
+        -Wl,-rpath,${OPENCV_RPATH} \
+        -lopencv_videoio -lopencv_imgcodecs -lopencv_imgproc -lopencv_core \
+        -lpthread ${EXTRA_LIBS} \
+        -o alloc_selfcheck
+fi
+
 # 复制到输出目录
 echo "[3/3] 复制到输出目录..."
 cp camera_display_ips200 "${OUTPUT_DIR}/"
+if [ "${ALLOC_TRACKING}" = "1" ]; then
+    cp alloc_selfcheck "${OUTPUT_DIR}/"
+fi
 
 echo ""
 echo "========================================"
@@ -93,4 +210,9 @@ echo "  scp ${OUTPUT_DIR}/camera_display_ips200 root@192.168.110.250:~/"
 echo ""
 echo "在板卡上运行："
 echo "  LD_LIBRARY_PATH=/home/root/opencv/lib ./camera_display_ips200"
+if [ "${ALLOC_TRACKING}" = "1" ]; then
+    echo ""
+    echo "内存分配自检（不需要摄像头，返回0为通过）："
+    echo "  LD_LIBRARY_PATH=/home/root/opencv/lib ./alloc_selfcheck"
+fi
 echo "========================================"
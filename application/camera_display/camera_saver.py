@@ -16,10 +16,14 @@ import os
 NETWORK_PORT = 8888
 RECV_BUFFER_SIZE = 65536
 
-# 图像包头结构体
+# 图像包头前20字节（版本1包头到此为止）
 HEADER_FORMAT = '<5I'
 HEADER_SIZE = struct.calcsize(HEADER_FORMAT)
-MAGIC_NUMBER = 0x12345678
+MAGIC_NUMBER = 0x12345679      # 版本2及以后（板卡端 --net-header-v2）：之后是 uint16_t header_size, version 与扩展字段
+MAGIC_NUMBER_V1 = 0x12345678   # 版本1（板卡端默认）
+EXT_FORMAT = '<2H'             # header_size, version
+EXT_SIZE = struct.calcsize(EXT_FORMAT)
+LUMA_FORMAT = '<4B'            # 版本2扩展字段：luma_mean, p5, p50, p95
 
 # 保存目录
 SAVE_DIR = "captured_frames"
@@ -32,6 +36,7 @@ class CameraViewer:
         self.connected = False
         self.frame_count = 0
         self.start_time = None
+        self.luma = None  # 最近一帧的亮度统计 (mean, p5, p50, p95)
 
         # 创建保存目录
         if not os.path.exists(SAVE_DIR):
@@ -62,6 +67,24 @@ class CameraViewer:
             data += packet
         return data
 
+    def recv_extension(self, magic):
+        """
+        读取版本2及以后的扩展包头（按 header_size 跳过不认识的字段）
+        返回亮度统计 (mean, p5, p50, p95)，版本1包头返回 None；连接断开时抛出异常
+        """
+        if magic == MAGIC_NUMBER_V1:
+            return None
+        ext = self.recv_exact(EXT_SIZE)
+        if not ext:
+            raise ConnectionError("扩展包头接收失败")
+        header_size, version = struct.unpack(EXT_FORMAT, ext)
+        rest = self.recv_exact(max(header_size - HEADER_SIZE - EXT_SIZE, 0))
+        if rest is None:
+            raise ConnectionError("扩展包头接收失败")
+        if len(rest) < struct.calcsize(LUMA_FORMAT):
+            return None
+        return struct.unpack_from(LUMA_FORMAT, rest)
+
     def receive_frame(self):
         """接收一帧图像"""
         try:
@@ -73,10 +96,11 @@ class CameraViewer:
             # 解析包头
             magic, width, height, data_size, timestamp = struct.unpack(HEADER_FORMAT, header_data)
 
-            # 验证魔数
-            if magic != MAGIC_NUMBER:
+            # 验证魔数，读取扩展包头
+            if magic not in (MAGIC_NUMBER, MAGIC_NUMBER_V1):
                 print(f"警告：魔数错误 0x{magic:08X}")
                 return None
+            self.luma = self.recv_extension(magic)
 
             # 接收图像数据
             image_data = self.recv_exact(data_size)
@@ -121,7 +145,10 @@ class CameraViewer:
                 if self.frame_count % 30 == 0:
                     elapsed = time.time() - self.start_time
                     fps = self.frame_count / elapsed
-                    print(f"帧率: {fps:.1f} FPS, 总帧数: {self.frame_count}")
+                    luma = ""
+                    if self.luma:
+                        luma = f", 亮度: 平均 {self.luma[0]} (p5/p50/p95 {self.luma[1]}/{self.luma[2]}/{self.luma[3]})"
+                    print(f"帧率: {fps:.1f} FPS, 总帧数: {self.frame_count}{luma}")
 
         except KeyboardInterrupt:
             print("\n用户中断（Ctrl+C）")
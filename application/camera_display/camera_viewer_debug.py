@@ -16,10 +16,14 @@ import time
 NETWORK_PORT = 8888
 RECV_BUFFER_SIZE = 65536
 
-# 图像包头结构体：uint32_t magic, width, height, data_size, timestamp
+# 图像包头前20字节：uint32_t magic, width, height, data_size, timestamp（版本1包头到此为止）
 HEADER_FORMAT = '<5I'  # Little-endian, 5个unsigned int (4字节)
 HEADER_SIZE = struct.calcsize(HEADER_FORMAT)
-MAGIC_NUMBER = 0x12345678
+MAGIC_NUMBER = 0x12345679      # 版本2及以后（板卡端 --net-header-v2）：之后是 uint16_t header_size, version 与扩展字段
+MAGIC_NUMBER_V1 = 0x12345678   # 版本1（板卡端默认）
+EXT_FORMAT = '<2H'             # header_size, version
+EXT_SIZE = struct.calcsize(EXT_FORMAT)
+LUMA_FORMAT = '<4B'            # 版本2扩展字段：luma_mean, p5, p50, p95
 
 
 class CameraViewer:
@@ -29,6 +33,7 @@ class CameraViewer:
         self.connected = False
         self.frame_count = 0
         self.start_time = None
+        self.luma = None  # 最近一帧的亮度统计 (mean, p5, p50, p95)
 
     def connect(self):
         """连接到板卡服务器"""
@@ -63,6 +68,24 @@ class CameraViewer:
             print(f"\n[错误] 接收数据异常: {e}，已接收 {len(data)}/{size} 字节")
             return None
 
+    def recv_extension(self, magic):
+        """
+        读取版本2及以后的扩展包头（按 header_size 跳过不认识的字段）
+        返回亮度统计 (mean, p5, p50, p95)，版本1包头返回 None；连接断开时抛出异常
+        """
+        if magic == MAGIC_NUMBER_V1:
+            return None
+        ext = self.recv_exact(EXT_SIZE)
+        if not ext:
+            raise ConnectionError("扩展包头接收失败")
+        header_size, version = struct.unpack(EXT_FORMAT, ext)
+        rest = self.recv_exact(max(header_size - HEADER_SIZE - EXT_SIZE, 0))
+        if rest is None:
+            raise ConnectionError("扩展包头接收失败")
+        if len(rest) < struct.calcsize(LUMA_FORMAT):
+            return None
+        return struct.unpack_from(LUMA_FORMAT, rest)
+
     def receive_frame(self, verbose=True):
         """接收一帧图像"""
         try:
@@ -82,15 +105,21 @@ class CameraViewer:
 
             if verbose:
                 print(f"[调试] 包头信息:")
-                print(f"  - 魔数: 0x{magic:08X} (期望: 0x{MAGIC_NUMBER:08X})")
+                print(f"  - 魔数: 0x{magic:08X} (期望: 0x{MAGIC_NUMBER:08X}，版本1为 0x{MAGIC_NUMBER_V1:08X})")
                 print(f"  - 图像尺寸: {width}x{height}")
                 print(f"  - 数据大小: {data_size} 字节")
                 print(f"  - 时间戳: {timestamp} ms")
 
-            # 3. 验证魔数
-            if magic != MAGIC_NUMBER:
+            # 3. 验证魔数，读取扩展包头
+            if magic not in (MAGIC_NUMBER, MAGIC_NUMBER_V1):
                 print(f"✗ 警告：魔数错误！")
                 return None
+            self.luma = self.recv_extension(magic)
+            if verbose:
+                if self.luma:
+                    print(f"  - 亮度: 平均 {self.luma[0]}, p5/p50/p95 {self.luma[1]}/{self.luma[2]}/{self.luma[3]}")
+                else:
+                    print(f"  - 亮度: 无（版本1包头或尚无统计）")
 
             # 4. 接收图像数据
             if verbose:
@@ -189,7 +218,10 @@ class CameraViewer:
                 if self.frame_count % 30 == 0:
                     elapsed = time.time() - self.start_time
                     fps = self.frame_count / elapsed
-                    print(f"\n📊 帧率统计: {fps:.1f} FPS, 总帧数: {self.frame_count}")
+                    luma = ""
+                    if self.luma:
+                        luma = f", 亮度: 平均 {self.luma[0]} (p5/p50/p95 {self.luma[1]}/{self.luma[2]}/{self.luma[3]})"
+                    print(f"\n📊 帧率统计: {fps:.1f} FPS, 总帧数: {self.frame_count}{luma}")
 
                 # 处理按键
                 key = cv2.waitKey(1) & 0xFF
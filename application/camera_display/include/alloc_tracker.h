@@ -0,0 +1,67 @@
+#ifndef _ALLOC_TRACKER_H_
+#define _ALLOC_TRACKER_H_
+
+#include <stdint.h>
+
+/*
+ * 采集线程内存分配统计（调试构建）：
+ *   cmake -DCAMERA_ALLOC_TRACKING=ON ..   或   ALLOC_TRACKING=1 ./build_simple.sh
+ *
+ * 启用后替换 malloc/calloc/realloc/memalign 系列（new 最终也经过 malloc），
+ * 按线程统计每帧分配次数。预热结束后采集线程一旦发生分配，程序报错并以非0状态退出。
+ *
+ * OpenCV/libjpeg 的 JPEG 解码每帧都会创建解码器，属于第三方库内部行为，
+ * 用 alloc_tracker_external_begin/end 包围后单独计数，只报告不判失败。
+ * 包围范围只限解码调用本身；解码结果写入的预分配缓冲若被重新分配（尺寸、类型变化），
+ * 由调用方检查后用 alloc_tracker_count_own 计入本程序分配。
+ *
+ * 不需要摄像头的自检程序 alloc_selfcheck 用合成图像驱动主循环的每帧处理，见 src/alloc_selfcheck.cpp。
+ *
+ * 未定义 CAMERA_ALLOC_TRACKING 时以下接口均为空操作。
+ */
+
+// 单帧分配次数
+struct AllocCounts {
+    uint32_t own;                       // 本程序代码路径中的分配
+    uint32_t external;                  // 第三方库（JPEG解码）内部的分配
+};
+
+#ifdef CAMERA_ALLOC_TRACKING
+
+/**
+ * @brief 开始统计当前线程的一帧
+ */
+void alloc_tracker_frame_begin();
+
+/**
+ * @brief 结束当前帧统计
+ * @param counts 输出本帧分配次数
+ */
+void alloc_tracker_frame_end(struct AllocCounts *counts);
+
+/**
+ * @brief 进入/离开第三方库调用（期间的分配计入 external）
+ */
+void alloc_tracker_external_begin();
+void alloc_tracker_external_end();
+
+/**
+ * @brief 计入本程序分配（第三方调用重新分配了本程序预分配的缓冲时调用）
+ * @param count 分配次数
+ */
+void alloc_tracker_count_own(uint32_t count);
+
+#else
+
+static inline void alloc_tracker_frame_begin() {}
+static inline void alloc_tracker_frame_end(struct AllocCounts *counts) {
+    counts->own = 0;
+    counts->external = 0;
+}
+static inline void alloc_tracker_external_begin() {}
+static inline void alloc_tracker_external_end() {}
+static inline void alloc_tracker_count_own(uint32_t) {}
+
+#endif // CAMERA_ALLOC_TRACKING
+
+#endif // _ALLOC_TRACKER_H_
@@ -0,0 +1,83 @@
+#ifndef _AUTO_EXPOSURE_H_
+#define _AUTO_EXPOSURE_H_
+
+#include <stdint.h>
+
+// 亮度统计配置
+#define LUMA_HIST_BINS        16          // 发布给客户端的直方图分箱数（每箱16级灰度）
+#define AE_DEFAULT_TARGET     110         // 默认目标平均亮度（0-255）
+#define AE_DEFAULT_INTERVAL   4           // 默认每4帧统计一次
+
+// 调节参数
+#define AE_UPDATE_MS          100         // 两次调节的最短间隔（等待新曝光生效）
+#define AE_DEADBAND           8           // 平均亮度与目标相差不超过该值时不调节
+#define AE_MAX_STEP_Q8        320         // 单次调节最大倍率 1.25（x256定点）
+
+/*
+ * 曝光上限按帧周期计算（V4L2 exposure_absolute 单位100us，110fps 时为 90），
+ * 并关闭 exposure_auto_priority，摄像头不会为了延长曝光而降低帧率。
+ * 曝光达到上限仍偏暗时再提高增益；偏亮时先降低增益再缩短曝光。
+ * 所有 V4L2 控制写入都在独立线程完成，采集线程只计算统计量。
+ */
+
+// 单帧亮度统计
+struct LumaStats {
+    uint8_t  mean;                      // 平均亮度
+    uint8_t  p5;                        // 5% 分位亮度（暗部）
+    uint8_t  p50;                       // 中位数
+    uint8_t  p95;                       // 95% 分位亮度（亮部）
+    uint32_t hist[LUMA_HIST_BINS];      // 灰度直方图（像素数）
+    uint32_t pixels;                    // 统计像素总数
+};
+
+/**
+ * @brief 计算灰度图像的直方图、分位数与平均亮度
+ *
+ * 标量实现，单次遍历：每次读8字节按移位拆出像素，计入4个子直方图后合并；
+ * 平均亮度由直方图加权求和得出，不再单独遍历图像。
+ * @param image 灰度图像数据
+ * @param pixels 像素数
+ * @param stats 输出统计结果
+ */
+void luma_stats_compute(const uint8_t *image, uint32_t pixels, struct LumaStats *stats);
+
+/**
+ * @brief 初始化自动曝光并启动调节线程（初始为关闭状态，不修改摄像头设置）
+ * @param fps 摄像头帧率，用于计算曝光上限
+ * @return 0:成功 -1:摄像头不支持手动曝光
+ */
+int auto_exposure_init(int fps);
+
+/**
+ * @brief 设置目标亮度
+ * @param target 目标平均亮度（1-255），0 关闭自动曝光
+ * @return 0:成功 -1:未初始化或参数错误
+ * @note 关闭后保持最后的曝光/增益，返回时调节线程已不会再写入摄像头
+ */
+int auto_exposure_set_target(int target);
+
+/**
+ * @brief 提交一帧亮度统计（采集线程调用，仅原子写入）
+ * @param stats 亮度统计
+ */
+void auto_exposure_update(const struct LumaStats *stats);
+
+/**
+ * @brief 摄像头重新打开后重新写入手动曝光模式与当前曝光/增益
+ */
+void auto_exposure_reapply();
+
+/**
+ * @brief 获取当前曝光与增益（自动曝光关闭时为最后一次写入的值）
+ * @param exposure 输出曝光值（单位100us）
+ * @param gain 输出增益，摄像头不支持增益时为 -1
+ * @return true: 自动曝光正在运行
+ */
+bool auto_exposure_get_state(int *exposure, int *gain);
+
+/**
+ * @brief 停止调节线程
+ */
+void auto_exposure_close();
+
+#endif // _AUTO_EXPOSURE_H_
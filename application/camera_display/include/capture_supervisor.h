@@ -0,0 +1,49 @@
+#ifndef _CAPTURE_SUPERVISOR_H_
+#define _CAPTURE_SUPERVISOR_H_
+
+#include <stdint.h>
+
+// 故障判定与恢复参数
+#define CAPTURE_FAIL_LIMIT          3       // 设备节点仍存在时，连续失败多少次判定为掉线（每次读取最长 UVC_READ_TIMEOUT_MS）
+#define CAPTURE_NO_SIGNAL_MS        100     // 掉线期间"无信号"帧输出间隔（毫秒）
+#define CAPTURE_RETRY_MS            500     // 未收到设备事件时的周期性重试间隔（毫秒）
+
+// 采集状态
+enum CaptureStatus {
+    CAPTURE_OK = 0,                 // 正常图像帧
+    CAPTURE_NO_SIGNAL,              // 设备掉线，输出"无信号"帧
+    CAPTURE_RECOVERED               // 设备恢复后的第一帧
+};
+
+/**
+ * @brief 初始化受监管的采集子系统（内部调用 uvc_camera_init）
+ * @param device_path 设备路径，通常为 "/dev/video0"
+ * @return 0:成功 -1:失败
+ */
+int capture_supervisor_init(const char *device_path);
+
+/**
+ * @brief 获取下一帧；摄像头掉线时不退出，而是等待设备恢复并返回"无信号"帧
+ * @param image 输出灰度图像指针（UVC_WIDTH x UVC_HEIGHT，始终有效）
+ * @return CaptureStatus
+ * @note 摄像头停止出图后，距上一帧超过 CAPTURE_NO_SIGNAL_MS 即开始返回"无信号"帧（单次读取最长阻塞
+ *       UVC_READ_TIMEOUT_MS）；掉线期间最长阻塞 CAPTURE_NO_SIGNAL_MS，便于调用方维持网络连接与显示
+ */
+enum CaptureStatus capture_supervisor_next_frame(uint8_t **image);
+
+/**
+ * @brief 获取最近一次掉线时长（毫秒），掉线中返回已持续时长，从未掉线返回0
+ */
+uint32_t capture_supervisor_last_outage_ms();
+
+/**
+ * @brief 获取累计掉线次数
+ */
+uint32_t capture_supervisor_outage_count();
+
+/**
+ * @brief 关闭采集子系统
+ */
+void capture_supervisor_close();
+
+#endif // _CAPTURE_SUPERVISOR_H_
@@ -0,0 +1,75 @@
+#ifndef _CONTROL_CHANNEL_H_
+#define _CONTROL_CHANNEL_H_
+
+#include <stdint.h>
+
+// 控制通道配置
+#define CONTROL_SOCKET_PATH   "/tmp/camera_display.sock"   // Unix socket路径
+#define CONTROL_MAX_CLIENTS   4                            // 最大同时连接数
+#define CONTROL_SOCKET_MODE   0600                         // socket文件权限：仅运行程序的用户可连接
+
+/*
+ * 文本命令（每行一条，回复以 OK/ERR 开头）：
+ *   get                         查看当前配置
+ *   exposure <值|auto>          曝光（V4L2 exposure_absolute，单位100us）或自动曝光
+ *   gain <值>                   增益（曝光/增益按摄像头报告的范围检查）
+ *   ae <目标亮度>|off           板上自动曝光（手动设置曝光/增益时自动关闭）
+ *   roi <x> <y> <w> <h> | off   网络输出裁剪区域
+ *   encoding gray|jpeg          WebSocket 默认输出编码
+ *   display on|off              IPS200 屏幕显示
+ *   fps <N>                     输出帧率上限（0：不限制），只限制屏幕与网络输出，采集、变化检测与批量采集保持全速
+ *
+ * 参数须为完整的十进制整数并在范围内，否则回复 ERR 且不修改配置。
+ * socket 文件权限为 CONTROL_SOCKET_MODE，其他用户需以相同用户或 root 运行客户端。
+ *
+ * 修改成功回复 "OK generation=<N>"；采集线程尚未释放旧快照时回复 "OK pending"，
+ * 配置由控制线程在宽限期过后发布（通常在下一帧内），可用 get 查看生效的版本号。
+ *
+ * 示例：echo "exposure 50" | socat - UNIX-CONNECT:/tmp/camera_display.sock
+ */
+
+// 运行时配置快照（发布后只读）
+struct RuntimeConfig {
+    uint32_t generation;            // 版本号，每次修改加1
+    bool     display_enabled;       // 屏幕显示开关
+    int      fps_cap;               // 输出帧率上限，0为不限制
+    uint16_t roi_x;                 // 网络输出裁剪区域，roi_w为0表示全图
+    uint16_t roi_y;
+    uint16_t roi_w;
+    uint16_t roi_h;
+    bool     ws_jpeg;               // WebSocket默认编码（true: JPEG）
+    int      exposure;              // 曝光值，-1为自动曝光
+    int      gain;                  // 增益，-1为保持摄像头默认
+    int      ae_target;             // 板上自动曝光目标亮度，0为关闭
+};
+
+/**
+ * @brief 启动控制通道线程
+ * @param socket_path Unix socket路径，为 NULL 时仅发布初始配置，不启动线程
+ * @param initial 初始配置
+ * @return 0:成功 -1:失败（初始配置仍可通过 control_config_acquire 读取）
+ */
+int control_channel_init(const char *socket_path, const struct RuntimeConfig *initial);
+
+/**
+ * @brief 获取当前配置快照（采集线程调用，仅一次原子读取，无锁）
+ * @return 配置快照指针，在下次调用 control_config_quiescent 之前保持有效
+ */
+const struct RuntimeConfig *control_config_acquire();
+
+/**
+ * @brief 采集线程声明已不再持有快照（每次主循环结束时调用）
+ */
+void control_config_quiescent();
+
+/**
+ * @brief 将当前配置中的曝光/增益或自动曝光重新写入摄像头（设备重新打开后调用）
+ */
+void control_channel_apply_camera();
+
+/**
+ * @brief 停止控制通道线程并删除socket文件
+ */
+void control_channel_close();
+
+#endif // _CONTROL_CHANNEL_H_
@@ -0,0 +1,112 @@
+#ifndef _FRAME_BATCH_H_
+#define _FRAME_BATCH_H_
+
+#include <stdint.h>
+
+// 批量采集配置
+#define BATCH_DEFAULT_FRAMES   32          // 每批帧数
+#define BATCH_MAX_FRAMES       256
+#define BATCH_DEFAULT_EVERY    10          // 默认每10帧抽取一帧
+#define BATCH_PREROLL_FRAMES   8           // 事件触发前保留的帧数
+#define BATCH_POSTROLL_FRAMES  16          // 事件结束后继续记录的帧数
+#define BATCH_ALIGN            64          // 帧数据对齐（字节）
+
+#define BATCH_MAGIC            0x54414246  // "FBAT"
+#define BATCH_VERSION          1
+#define BATCH_FLAG_ZLIB        0x01        // 头部之后的内容经过 zlib 压缩
+
+/*
+ * 批文件布局（小端，未压缩时可直接内存映射）：
+ *
+ *   [0, 64)                    BatchFileHeader
+ *   [meta_offset, ...)         BatchFrameMeta x frame_count
+ *   [data_offset, ...)         帧数据 x frame_count，每帧占 frame_stride 字节（64字节对齐），
+ *                              前 width*height 字节为灰度图像
+ *
+ * 压缩时文件为 64 字节头部 + zlib(头部之后的全部内容)，解压后偏移与未压缩时相同。
+ * 每批一次 write() 写入 <目录>/batch_<序号>.fbat.part，写完后重命名为 .fbat。
+ * 读取示例见 batch_loader.py。
+ */
+
+// 文件头（64字节）
+struct BatchFileHeader {
+    uint32_t magic;                 // BATCH_MAGIC
+    uint16_t version;               // BATCH_VERSION
+    uint16_t header_size;           // sizeof(BatchFileHeader)
+    uint32_t frame_count;           // 本批帧数
+    uint16_t width;                 // 图像宽度
+    uint16_t height;                // 图像高度
+    uint32_t frame_stride;          // 每帧占用字节数（64字节对齐）
+    uint32_t meta_offset;           // 元数据数组偏移
+    uint32_t data_offset;           // 第一帧数据偏移（64字节对齐）
+    uint32_t flags;                 // BATCH_FLAG_*
+    uint64_t batch_sequence;        // 批序号（从0开始）
+    uint32_t payload_size;          // 头部之后实际存储的字节数
+    uint32_t raw_size;              // 未压缩时的文件总大小
+    uint8_t  reserved[16];
+};
+
+// 触发原因
+enum BatchReason {
+    BATCH_REASON_SAMPLE = 0,        // 定间隔抽帧
+    BATCH_REASON_PREROLL,           // 事件前保留帧
+    BATCH_REASON_EVENT              // 事件期间及结束后的帧
+};
+
+// 单帧元数据（32字节）
+struct BatchFrameMeta {
+    uint32_t frame_index;           // 采集帧号
+    uint32_t reason;                // BatchReason
+    uint64_t timestamp_us;          // 采集时间（单调时钟，微秒）
+    uint32_t motion_score;          // 全帧平均灰度差 x256（未启用变化检测时为0）
+    uint8_t  luma_mean;             // 平均亮度（未统计时为0）
+    uint8_t  reserved[11];
+};
+
+// 批量采集参数
+struct FrameBatchConfig {
+    const char *dir;                // 输出目录
+    uint16_t width;
+    uint16_t height;
+    int batch_frames;               // 每批帧数 K
+    int sample_every;               // 每N帧抽取一帧，0为不抽帧
+    bool event_trigger;             // 变化检测触发时连续记录（含前后若干帧）
+    bool compress;                  // zlib 压缩（需 HAVE_ZLIB 构建）
+};
+
+// 每帧附带信息
+struct BatchFrameInfo {
+    uint32_t frame_index;
+    uint64_t timestamp_us;
+    bool     event;                 // 当前帧是否检测到变化
+    uint32_t motion_score;
+    uint8_t  luma_mean;
+};
+
+/**
+ * @brief 初始化批量采集（预分配缓冲并启动写盘线程）
+ * @param config 参数
+ * @return 0:成功 -1:失败
+ */
+int frame_batch_init(const struct FrameBatchConfig *config);
+
+/**
+ * @brief 提交一帧（采集线程每帧调用，只拷贝被选中的帧，不进行文件IO）
+ * @param image 灰度图像（尺寸与初始化时一致）
+ * @param info 帧信息
+ */
+void frame_batch_submit(const uint8_t *image, const struct BatchFrameInfo *info);
+
+/**
+ * @brief 获取统计
+ * @param written 已写入批数
+ * @param dropped 因写盘跟不上而丢弃的批数
+ */
+void frame_batch_get_stats(uint64_t *written, uint64_t *dropped);
+
+/**
+ * @brief 写出未满的最后一批并停止写盘线程
+ */
+void frame_batch_close();
+
+#endif // _FRAME_BATCH_H_
@@ -0,0 +1,56 @@
+#ifndef _GEO_REMAP_H_
+#define _GEO_REMAP_H_
+
+#include <stdint.h>
+
+// 输出目标（按位组合，选择哪些输出使用校正后的图像）
+#define GEO_SINK_NETWORK   0x01        // TCP 8888 网络流
+#define GEO_SINK_HTTP      0x02        // HTTP/WebSocket
+#define GEO_SINK_DISPLAY   0x04        // IPS200 屏幕
+#define GEO_SINK_ALL       (GEO_SINK_NETWORK | GEO_SINK_HTTP | GEO_SINK_DISPLAY)
+
+// 插值方式
+enum GeoInterp {
+    GEO_INTERP_NEAREST = 0,
+    GEO_INTERP_BILINEAR
+};
+
+/*
+ * 标定文件格式（文本，每行 "键 = 值"，# 开头为注释，未给出的项使用默认值）：
+ *   fx = 120.0          相机内参（像素），fx 为0时不做畸变校正
+ *   fy = 120.0
+ *   cx = 80.0
+ *   cy = 60.0
+ *   k1 = -0.30          径向畸变
+ *   k2 = 0.08
+ *   k3 = 0.0
+ *   p1 = 0.0            切向畸变
+ *   p2 = 0.0
+ *   H = h00 h01 h02 h10 h11 h12 h20 h21 h22
+ *                       透视变换（输出像素 -> 去畸变图像像素，行优先），省略则为单位阵
+ */
+
+/**
+ * @brief 加载标定文件并预计算定点重映射表（分块存储）
+ * @param calib_path 标定文件路径
+ * @param width 图像宽度（输入输出相同）
+ * @param height 图像高度
+ * @return 0:成功 -1:失败
+ */
+int geo_remap_init(const char *calib_path, uint16_t width, uint16_t height);
+
+/**
+ * @brief 对一帧灰度图像进行几何校正
+ * @param src 输入灰度图像
+ * @param dst 输出灰度图像（与输入尺寸相同，不能与src重叠）
+ * @param interp 插值方式
+ * @return 0:成功 -1:未初始化
+ */
+int geo_remap_apply(const uint8_t *src, uint8_t *dst, enum GeoInterp interp);
+
+/**
+ * @brief 释放重映射表
+ */
+void geo_remap_close();
+
+#endif // _GEO_REMAP_H_
@@ -0,0 +1,82 @@
+#ifndef _HTTP_STREAM_H_
+#define _HTTP_STREAM_H_
+
+#include <stdint.h>
+#include "auto_exposure.h"
+
+// HTTP服务配置
+#define HTTP_PORT           8080        // HTTP端口
+#define HTTP_MAX_CLIENTS    32          // 最大同时连接数（含MJPEG与WebSocket）
+#define HTTP_JPEG_QUALITY   80          // 无原始JPEG时的编码质量
+
+/*
+ * 访问路径：
+ *   /               浏览器查看页面
+ *   /stream.mjpg    multipart/x-mixed-replace MJPEG 流
+ *   /ws             WebSocket 二进制帧（?format=gray 原始灰度，?format=jpeg JPEG，
+ *                   未指定时使用 http_stream_set_default_jpeg 设置的默认编码）
+ *   /stats          JSON 运行统计（含亮度直方图与曝光状态）
+ *
+ * 亮度统计随帧发布：MJPEG 分段头 X-Luma-Mean / X-Luma-Percentiles（p5,p50,p95），
+ * WebSocket 消息头 luma_* 字段（无统计时为0）；TCP 8888 见 network_stream.h 版本2包头。
+ */
+
+// WebSocket 消息头版本：图像数据从消息的 header_size 偏移处开始，
+// 之后的版本只在末尾追加字段，解析方跳过不认识的部分
+#define WS_FRAME_VERSION    2
+
+// WebSocket 二进制消息头（小端，紧跟图像数据）
+struct WsFrameHeader {
+    uint32_t magic;                 // 魔数：0x12345678
+    uint16_t header_size;           // 消息头长度（字节）
+    uint16_t version;               // 消息头版本（WS_FRAME_VERSION）
+    uint16_t width;                 // 图像宽度
+    uint16_t height;                // 图像高度
+    uint32_t format;                // 0:灰度原始数据 1:JPEG
+    uint32_t sequence;              // 帧序号
+    uint32_t timestamp;             // 时间戳（毫秒）
+    uint32_t data_size;             // 数据大小（字节）
+    uint8_t  luma_mean;             // 平均亮度
+    uint8_t  luma_p5;               // 5% 分位亮度
+    uint8_t  luma_p50;              // 中位数
+    uint8_t  luma_p95;              // 95% 分位亮度
+};
+
+/**
+ * @brief 初始化HTTP服务器并启动网络线程（epoll单线程）
+ * @param port TCP端口号
+ * @return 0:成功 -1:失败
+ */
+int http_stream_init(int port);
+
+/**
+ * @brief 向HTTP客户端发布一帧图像（采集线程调用，仅拷贝数据后立即返回，不加锁）
+ * @param gray 灰度图像数据
+ * @param width 图像宽度
+ * @param height 图像高度
+ * @param jpeg 摄像头原始JPEG数据（可为NULL，此时按需在网络线程编码）
+ * @param jpeg_size JPEG数据长度
+ * @param luma 该帧（或最近一次）的亮度统计，可为NULL
+ */
+void http_stream_publish(const uint8_t *gray, uint16_t width, uint16_t height,
+                         const uint8_t *jpeg, uint32_t jpeg_size,
+                         const struct LumaStats *luma);
+
+/**
+ * @brief 设置WebSocket客户端未指定format时的默认编码（对之后建立的连接生效）
+ * @param jpeg true: JPEG, false: 原始灰度
+ */
+void http_stream_set_default_jpeg(bool jpeg);
+
+/**
+ * @brief 获取当前HTTP流客户端数量（MJPEG + WebSocket）
+ * @return 客户端数量
+ */
+int http_stream_get_clients();
+
+/**
+ * @brief 停止网络线程并关闭HTTP服务器
+ */
+void http_stream_close();
+
+#endif // _HTTP_STREAM_H_
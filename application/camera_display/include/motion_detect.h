@@ -0,0 +1,55 @@
+#ifndef _MOTION_DETECT_H_
+#define _MOTION_DETECT_H_
+
+#include <stdint.h>
+
+// 分块配置：16x8像素一块（宽度正好一个SIMD寄存器），160x120图像共 10x15=150 块
+#define MOTION_TILE_W        16
+#define MOTION_TILE_H        8
+#define MOTION_MAX_TILES_X   16
+#define MOTION_MAX_TILES_Y   32
+#define MOTION_MAX_TILES     (MOTION_MAX_TILES_X * MOTION_MAX_TILES_Y)
+
+// 默认阈值：块内平均灰度差（0-255）超过该值视为变化
+#define MOTION_DEFAULT_TILE_THRESHOLD  6
+
+// 单帧变化检测结果
+struct MotionResult {
+    uint32_t score;                 // 全帧平均灰度差 x256（定点）
+    uint16_t tiles_x;               // 横向块数
+    uint16_t tiles_y;               // 纵向块数
+    uint16_t dirty_count;           // 变化块数量
+    bool     changed;               // 是否存在变化块
+    uint8_t  dirty[MOTION_MAX_TILES];   // 变化块掩码，按行优先排列（1：变化）
+};
+
+/**
+ * @brief 初始化变化检测
+ * @param width 图像宽度（需为16的倍数）
+ * @param height 图像高度（需为8的倍数）
+ * @param tile_threshold 块内平均灰度差阈值
+ * @return 0:成功 -1:失败
+ */
+int motion_detect_init(uint16_t width, uint16_t height, uint8_t tile_threshold);
+
+/**
+ * @brief 将当前帧与参考帧进行分块比较（隔行降采样SAD）
+ * @param image 灰度图像数据指针
+ * @param result 输出检测结果
+ * @return 0:成功 -1:失败
+ * @note 仅当检测到变化时才更新参考帧，缓慢变化会累积直至超过阈值
+ */
+int motion_detect_process(const uint8_t *image, struct MotionResult *result);
+
+/**
+ * @brief 强制以当前帧作为参考帧（例如发送关键帧后）
+ * @param image 灰度图像数据指针
+ */
+void motion_detect_set_reference(const uint8_t *image);
+
+/**
+ * @brief 释放变化检测资源
+ */
+void motion_detect_close();
+
+#endif // _MOTION_DETECT_H_
@@ -2,18 +2,36 @@
 #define _NETWORK_STREAM_H_
 
 #include <stdint.h>
+#include "auto_exposure.h"
 
 // 网络传输配置
 #define NETWORK_PORT 8888           // TCP端口
 #define MAX_CLIENTS  2              // 最大客户端连接数
 
-// 图像数据包头
+// 包头魔数与版本
+#define IMAGE_MAGIC_V1          0x12345678  // 版本1：20字节包头（magic ~ timestamp）
+#define IMAGE_MAGIC_V2          0x12345679  // 版本2及以后：扩展包头，总长度见 header_size
+#define IMAGE_HEADER_VERSION    2
+#define IMAGE_HEADER_V1_SIZE    20
+
+/*
+ * 图像数据包头（小端，紧跟图像数据）
+ * 前20字节与版本1布局相同；版本2起 magic 为 IMAGE_MAGIC_V2，之后的版本只在末尾追加字段，
+ * 解析方按 header_size 跳过不认识的字段。默认只发送前20字节（魔数为 IMAGE_MAGIC_V1），与旧客户端兼容；
+ * --net-header-v2 时发送完整包头。
+ */
 struct ImageHeader {
-    uint32_t magic;                 // 魔数：0x12345678
+    uint32_t magic;                 // 魔数
     uint32_t width;                 // 图像宽度
     uint32_t height;                // 图像高度
     uint32_t data_size;             // 数据大小（字节）
     uint32_t timestamp;             // 时间戳（毫秒）
+    uint16_t header_size;           // 包头总长度（字节）（版本2起）
+    uint16_t version;               // 包头版本（版本2起）
+    uint8_t  luma_mean;             // 平均亮度，无统计时为0（版本2起）
+    uint8_t  luma_p5;               // 5% 分位亮度
+    uint8_t  luma_p50;              // 中位数
+    uint8_t  luma_p95;              // 95% 分位亮度
 };
 
 /**
@@ -23,14 +41,22 @@ struct ImageHeader {
  */
 int network_stream_init(int port);
 
+/**
+ * @brief 发送当前版本包头（含亮度统计），客户端需支持 IMAGE_MAGIC_V2
+ * @param enable true: 当前版本 false: 版本1包头（20字节，默认）
+ */
+void network_stream_set_extended_header(bool enable);
+
 /**
  * @brief 发送图像数据到所有连接的客户端
  * @param image 图像数据指针（灰度图）
  * @param width 图像宽度
  * @param height 图像高度
+ * @param luma 该帧（或最近一次）的亮度统计，可为NULL
  * @return 发送的客户端数量
  */
-int network_stream_send(const uint8_t *image, uint16_t width, uint16_t height);
+int network_stream_send(const uint8_t *image, uint16_t width, uint16_t height,
+                        const struct LumaStats *luma);
 
 /**
  * @brief 获取当前连接的客户端数量
@@ -0,0 +1,135 @@
+#ifndef _RING_LOGGER_H_
+#define _RING_LOGGER_H_
+
+#include <stdint.h>
+#include <string.h>
+
+// 日志队列配置
+#define RING_LOG_SLOTS        256         // 队列槽数（2的幂），写满时丢弃新日志
+#define RING_LOG_MAX_ARGS     6           // 单条日志最多参数个数
+#define RING_LOG_STR_MAX      32          // 字符串参数最大长度（含结尾0，超出截断）
+#define RING_LOG_FLUSH_MS     20          // 输出线程空闲轮询间隔
+
+/*
+ * 实时路径日志：调用方只把格式串指针与参数值拷贝进无锁队列（多生产者多消费者环形队列，
+ * 每槽一个序号），不格式化、不分配内存、不进入系统调用；由独立线程取出后格式化输出。
+ *
+ *   ring_log("新客户端连接 [%d/%d]\n", count, MAX_CLIENTS);
+ *
+ * 限制：
+ *   - fmt 必须是字符串常量（只保存指针）
+ *   - 参数仅支持整数、浮点数与字符串（字符串会被拷贝）
+ *   - 整数参数统一按 long long 输出，格式串中的长度修饰符（h/l/ll/z）会被忽略
+ */
+
+enum RingLogArgType {
+    RING_ARG_INT = 0,
+    RING_ARG_DOUBLE,
+    RING_ARG_STRING
+};
+
+struct RingLogArg {
+    uint8_t type;
+    union {
+        long long i;
+        double d;
+        char s[RING_LOG_STR_MAX];
+    } value;
+};
+
+struct RingLogRecord {
+    const char *fmt;
+    bool to_stderr;
+    uint8_t argc;
+    RingLogArg args[RING_LOG_MAX_ARGS];
+};
+
+/**
+ * @brief 启动日志输出线程
+ * @return 0:成功 -1:失败（此时日志在调用线程中直接输出）
+ */
+int ring_logger_init();
+
+/**
+ * @brief 输出剩余日志并停止输出线程
+ */
+void ring_logger_close();
+
+/**
+ * @brief 获取因队列写满而丢弃的日志条数
+ */
+uint64_t ring_logger_dropped();
+
+/**
+ * @brief 将一条日志放入队列（由 ring_log / ring_log_error 调用）
+ */
+void ring_logger_push(const RingLogRecord *record);
+
+// ==================== 参数打包（模板，仅头文件） ====================
+
+namespace ring_logger_detail {
+
+inline void pack_one(RingLogArg *arg, long long v) { arg->type = RING_ARG_INT; arg->value.i = v; }
+inline void pack_one(RingLogArg *arg, int v) { pack_one(arg, (long long)v); }
+inline void pack_one(RingLogArg *arg, unsigned int v) { pack_one(arg, (long long)v); }
+inline void pack_one(RingLogArg *arg, long v) { pack_one(arg, (long long)v); }
+inline void pack_one(RingLogArg *arg, unsigned long v) { pack_one(arg, (long long)v); }
+inline void pack_one(RingLogArg *arg, unsigned long long v) { pack_one(arg, (long long)v); }
+inline void pack_one(RingLogArg *arg, short v) { pack_one(arg, (long long)v); }
+inline void pack_one(RingLogArg *arg, unsigned short v) { pack_one(arg, (long long)v); }
+inline void pack_one(RingLogArg *arg, char v) { pack_one(arg, (long long)v); }
+inline void pack_one(RingLogArg *arg, unsigned char v) { pack_one(arg, (long long)v); }
+inline void pack_one(RingLogArg *arg, bool v) { pack_one(arg, (long long)v); }
+inline void pack_one(RingLogArg *arg, double v) { arg->type = RING_ARG_DOUBLE; arg->value.d = v; }
+inline void pack_one(RingLogArg *arg, float v) { pack_one(arg, (double)v); }
+inline void pack_one(RingLogArg *arg, const char *v) {
+    if (v == NULL) v = "(null)";
+    size_t len = strnlen(v, RING_LOG_STR_MAX - 1);
+    // 截断时退回到完整的UTF-8字符边界
+    if (v[len] != '\0') {
+        while (len > 0 && ((uint8_t)v[len] & 0xC0) == 0x80) len--;
+    }
+    arg->type = RING_ARG_STRING;
+    memcpy(arg->value.s, v, len);
+    arg->value.s[len] = '\0';
+}
+
+inline void pack(RingLogRecord *) {
+}
+
+template <typename T, typename... Rest>
+inline void pack(RingLogRecord *record, T first, Rest... rest) {
+    pack_one(&record->args[record->argc++], first);
+    pack(record, rest...);
+}
+
+template <typename... Args>
+inline void emit(bool to_stderr, const char *fmt, Args... args) {
+    static_assert(sizeof...(Args) <= RING_LOG_MAX_ARGS, "ring_log: 参数过多");
+    RingLogRecord record;
+    record.fmt = fmt;
+    record.to_stderr = to_stderr;
+    record.argc = 0;
+    pack(&record, args...);
+    ring_logger_push(&record);
+}
+
+} // namespace ring_logger_detail
+
+/**
+ * @brief 输出到 stdout（实时路径可用）
+ */
+template <typename... Args>
+inline void ring_log(const char *fmt, Args... args) {
+    ring_logger_detail::emit(false, fmt, args...);
+}
+
+/**
+ * @brief 输出到 stderr（实时路径可用）
+ */
+template <typename... Args>
+inline void ring_log_error(const char *fmt, Args... args) {
+    ring_logger_detail::emit(true, fmt, args...);
+}
+
+#endif // _RING_LOGGER_H_
@@ -0,0 +1,62 @@
+#ifndef _RT_PROFILE_H_
+#define _RT_PROFILE_H_
+
+#include <stddef.h>
+
+// 线程角色（用于绑核与实时优先级配置）
+enum RtThreadRole {
+    RT_ROLE_CAPTURE = 0,            // 采集线程（主循环）
+    RT_ROLE_PROCESS,                // 图像处理线程
+    RT_ROLE_NETWORK,                // 网络发送线程
+    RT_ROLE_COUNT
+};
+
+// 运行时配置
+struct RtProfileConfig {
+    bool enabled;                   // 是否启用实时运行配置
+    int  cpu[RT_ROLE_COUNT];        // 各角色绑定的CPU核（-1：不绑定）
+    int  priority[RT_ROLE_COUNT];   // SCHED_FIFO优先级（0：保持普通调度）
+    bool lock_memory;               // 是否 mlockall 锁定内存
+};
+
+/**
+ * @brief 填充默认配置（未启用，采集绑定CPU1，优先级80/70/60）
+ * @param config 配置结构体指针
+ */
+void rt_profile_default_config(struct RtProfileConfig *config);
+
+/**
+ * @brief 初始化实时运行配置（记录配置与统计基准，不修改调用线程）
+ * @param config 配置
+ * @note 需在创建任何工作线程之前调用，各线程启动时通过 rt_profile_apply_thread 应用自己的角色；
+ *       主线程最后再应用采集角色，避免之后创建的线程继承采集线程的绑核与优先级
+ */
+void rt_profile_init(const struct RtProfileConfig *config);
+
+/**
+ * @brief 对调用线程应用指定角色的绑核与调度策略
+ * @param role 线程角色
+ * @return 0:成功 1:降级运行
+ */
+int rt_profile_apply_thread(enum RtThreadRole role);
+
+/**
+ * @brief 锁定进程内存（mlockall），应在所有缓冲区与显存映射建立后调用
+ * @return 0:成功 1:降级运行
+ */
+int rt_profile_lock_memory();
+
+/**
+ * @brief 预先触发缓冲区缺页，避免主循环中首次访问产生缺页中断
+ * @param buf 缓冲区指针
+ * @param len 缓冲区长度（字节）
+ */
+void rt_profile_prefault(void *buf, size_t len);
+
+/**
+ * @brief 打印采集线程自上次调用以来的缺页与上下文切换速率（次/秒）
+ * @note 按线程统计（RUSAGE_THREAD），须在采集线程调用；基准在采集线程应用 RT_ROLE_CAPTURE 时重新记录
+ */
+void rt_profile_report();
+
+#endif // _RT_PROFILE_H_
@@ -0,0 +1,81 @@
+#ifndef _SIMD_VEC_H_
+#define _SIMD_VEC_H_
+
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * 可移植128位向量（GCC vector_size 扩展，g++ 4.8 及以上）：
+ * 不依赖具体指令集，由编译器选择目标指令：
+ *   x86                     SSE2
+ *   LoongArch（-mlsx）       LSX 128位向量指令
+ *   LoongArch（未启用LSX）   拆分为64位通用寄存器运算
+ * x86 上各模块保留手写 SSE2 路径，其他平台使用本文件中的实现。
+ */
+#if defined(__GNUC__)
+
+#define SIMD_VEC_AVAILABLE 1
+
+typedef uint8_t  vec_u8x16 __attribute__((vector_size(16)));
+typedef int8_t   vec_i8x16 __attribute__((vector_size(16)));
+typedef uint16_t vec_u16x8 __attribute__((vector_size(16)));
+
+/**
+ * @brief 非对齐读取16字节
+ */
+static inline vec_u8x16 vec_load_u8(const uint8_t *p) {
+    vec_u8x16 v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+/**
+ * @brief 逐字节绝对差 |a - b|
+ */
+static inline vec_u8x16 vec_absdiff_u8(vec_u8x16 a, vec_u8x16 b) {
+    vec_u8x16 gt = (vec_u8x16)(a > b);
+    return ((a - b) & gt) | ((b - a) & ~gt);
+}
+
+/**
+ * @brief 相邻两字节相加，得到8个16位和
+ */
+static inline vec_u16x8 vec_pairsum_u8(vec_u8x16 v) {
+    vec_u16x8 w = (vec_u16x8)v;
+    return (w & 0xff) + (w >> 8);
+}
+
+/**
+ * @brief 8个16位通道求和
+ */
+static inline uint32_t vec_hsum_u16(vec_u16x8 v) {
+    uint32_t sum = 0;
+    for (int i = 0; i < 8; i++) {
+        sum += v[i];
+    }
+    return sum;
+}
+
+/**
+ * @brief 读取8字节并零扩展为8个16位通道
+ */
+static inline vec_u16x8 vec_load_u8x8(const uint8_t *p) {
+    vec_u16x8 v = { p[0], p[1], p[2], p[3], p[4], p[5], p[6], p[7] };
+    return v;
+}
+
+/**
+ * @brief 两组16位通道（值不超过255）截取低字节合并为16字节
+ */
+static inline vec_u8x16 vec_narrow_u16(vec_u16x8 lo, vec_u16x8 hi) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    const vec_u8x16 sel = { 0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30 };
+#else
+    const vec_u8x16 sel = { 1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31 };
+#endif
+    return __builtin_shuffle((vec_u8x16)lo, (vec_u8x16)hi, sel);
+}
+
+#endif // __GNUC__
+
+#endif // _SIMD_VEC_H_
@@ -8,6 +8,12 @@
 #define UVC_HEIGHT  120
 #define UVC_FPS     110
 
+// ζ֡ȴ룩ͷֹͣͼ豸ڵʱȡ OpenCV ĬϵԼ10
+#define UVC_READ_TIMEOUT_MS  100
+
+// Э̸ʽ棺״̽Ⲣ֤д룬֮󿪻ֱӦã̽ض
+#define UVC_FORMAT_CACHE_PATH  "/var/lib/camera_display.format"
+
 /**
  * @brief ʼ UVC ͷ
  * @param device_path 豸·ͨΪ "/dev/video0"
@@ -15,6 +21,25 @@
  */
 int uvc_camera_init(const char *device_path);
 
+/**
+ * @brief Э̸ʽļ uvc_camera_init ֮ǰã
+ * @param path ļ·NULL Ϊʹû棨ÿ̽⣩
+ */
+void uvc_camera_set_format_cache(const char *path);
+
+/**
+ * @brief γʼǷֱʹ˻ĸʽ
+ * @return true: ʹû, false: ̽
+ */
+bool uvc_camera_format_cached();
+
+/**
+ * @brief ʹϴЭ̳ɹĸʽ´ͷ豸Ȳλָ
+ * @return 0: ɹ, -1: ʧ
+ * @note ʽֱ֤̽Ӧϴε FOURCC/ֱ/֡
+ */
+int uvc_camera_reopen();
+
 /**
  * @brief ȴȡµͼ֡
  * @return 0: ɹ, -1: ʧ
@@ -27,6 +52,47 @@ int wait_image_refresh();
  */
 uint8_t* get_gray_image();
 
+/**
+ * @brief Ƿͷԭʼ MJPEG ݣ uvc_camera_init ֮ǰã
+ * @param enable true: رOpenCVRGBתֱӽΪҶͼJPEGԭʼ
+ * @note  HTTP MJPEG ֱת±
+ */
+void uvc_camera_set_jpeg_passthrough(bool enable);
+
+/**
+ * @brief ȡǰ֡ԭʼ JPEG 
+ * @param size JPEGݳȣֽڣ
+ * @return JPEGָ룬δֱͨͷMJPEGʽʱ NULL
+ */
+const uint8_t* get_jpeg_image(uint32_t *size);
+
+/**
+ * @brief  V4L2 ع⡢ȣڲɼ֮߳
+ * @param id ID V4L2_CID_EXPOSURE_ABSOLUTEV4L2_CID_GAIN
+ * @param value ֵ
+ * @return 0: ɹ, -1: ʧ
+ * @note ʹö豸 OpenCVӰɼɲɼ߳豸/رʱ
+ *       ڿ̵߳ã豸δʱ -1
+ */
+int uvc_camera_set_control(uint32_t id, int32_t value);
+
+/**
+ * @brief ȡ V4L2 
+ * @param id ID
+ * @param value ֵ
+ * @return 0: ɹ, -1: ʧ
+ */
+int uvc_camera_get_control(uint32_t id, int32_t *value);
+
+/**
+ * @brief ѯ V4L2 ȡֵΧ
+ * @param id ID
+ * @param min Сֵ
+ * @param max ֵ
+ * @return 0: ɹ, -1: ͷָ֧ÿ
+ */
+int uvc_camera_query_control(uint32_t id, int32_t *min, int32_t *max);
+
 /**
  * @brief رͷ
  */
@@ -0,0 +1,298 @@
+/*
+ * 采集循环内存分配自检（需 CAMERA_ALLOC_TRACKING 构建）：
+ *   ALLOC_TRACKING=1 ./build_simple.sh        生成 alloc_selfcheck
+ *   cmake -DCAMERA_ALLOC_TRACKING=ON ..       目标 alloc_selfcheck
+ *
+ * 不需要摄像头与屏幕：用合成图像按主循环的顺序驱动每帧处理（配置快照、亮度统计、几何校正、
+ * 变化检测、批量采集、TCP/HTTP 发送、日志），本机回环连接一个 TCP 客户端和一个 MJPEG 客户端，
+ * 预热后任何一帧发生本程序分配即失败。
+ * 摄像头读取与JPEG解码需要真实设备，由 camera_display_ips200 运行时的同一检查覆盖。
+ *
+ * 用法：./alloc_selfcheck [稳态帧数]    返回 0 通过，3 失败，1 初始化失败
+ */
+
+#include "uvc_camera.h"
+#include "network_stream.h"
+#include "http_stream.h"
+#include "motion_detect.h"
+#include "geo_remap.h"
+#include "control_channel.h"
+#include "auto_exposure.h"
+#include "ring_logger.h"
+#include "alloc_tracker.h"
+#include "frame_batch.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <atomic>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#ifndef CAMERA_ALLOC_TRACKING
+#error "alloc_selfcheck 需要以 -DCAMERA_ALLOC_TRACKING 构建"
+#endif
+
+#define SELFCHECK_TCP_PORT       18888       // 避开正式程序的 8888/8080
+#define SELFCHECK_HTTP_PORT      18080
+#define SELFCHECK_WARMUP_FRAMES  60          // 预热帧数（客户端接入、各模块首次使用）
+#define SELFCHECK_DEFAULT_FRAMES 1000
+#define SELFCHECK_PHASE_FRAMES   50          // 画面运动/静止交替周期，触发变化检测与批量采集事件
+#define SELFCHECK_FAIL_EXIT_CODE 3           // 与 camera_display_ips200 的检查失败退出码相同
+
+static std::atomic<bool> drain_running(false);
+static int drain_fds[2] = { -1, -1 };
+
+static uint64_t monotonic_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+/**
+ * @brief 合成一帧：斜向渐变背景，运动阶段叠加移动的亮块，静止阶段画面不变
+ */
+static void render_frame(uint8_t *image, int index) {
+    bool moving = (index / SELFCHECK_PHASE_FRAMES) % 2 == 0;
+    int t = moving ? index : (index / SELFCHECK_PHASE_FRAMES) * SELFCHECK_PHASE_FRAMES;
+    int box_x = (t * 3) % (UVC_WIDTH - 24);
+    int box_y = (t * 2) % (UVC_HEIGHT - 24);
+    for (int y = 0; y < UVC_HEIGHT; y++) {
+        for (int x = 0; x < UVC_WIDTH; x++) {
+            bool in_box = x >= box_x && x < box_x + 24 && y >= box_y && y < box_y + 24;
+            image[y * UVC_WIDTH + x] = in_box ? 240 : (uint8_t)(40 + (x + y) / 2);
+        }
+    }
+}
+
+/**
+ * @brief 回环连接本机端口
+ * @param request 连接后发送的请求，NULL 为不发送
+ * @return 套接字，失败返回 -1
+ */
+static int connect_loopback(int port, const char *request) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        (request != NULL && send(fd, request, strlen(request), 0) < 0)) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief 客户端读取线程：持续丢弃收到的数据，避免发送缓冲写满后客户端被断开
+ */
+static void *drain_loop(void *) {
+    static uint8_t buffer[16384];
+    while (drain_running.load()) {
+        for (int i = 0; i < 2; i++) {
+            if (drain_fds[i] >= 0 && recv(drain_fds[i], buffer, sizeof(buffer), MSG_DONTWAIT) == 0) {
+                drain_fds[i] = -1;
+            }
+        }
+        usleep(1000);
+    }
+    return NULL;
+}
+
+/**
+ * @brief 写入几何校正标定文件（含畸变，重映射表覆盖插值与越界像素）
+ */
+static int write_calib(const char *path) {
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL) {
+        perror("写入标定文件失败");
+        return -1;
+    }
+    fprintf(fp, "fx = 120.0\nfy = 120.0\ncx = 80.0\ncy = 60.0\nk1 = -0.30\nk2 = 0.08\n");
+    fclose(fp);
+    return 0;
+}
+
+/**
+ * @brief 删除临时目录及其中的文件
+ */
+static void remove_dir(const char *dir) {
+    DIR *dp = opendir(dir);
+    if (dp == NULL) {
+        return;
+    }
+    char path[512];
+    struct dirent *entry;
+    while ((entry = readdir(dp)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        if (snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name) < (int)sizeof(path)) {
+            unlink(path);
+        }
+    }
+    closedir(dp);
+    rmdir(dir);
+}
+
+int main(int argc, char *argv[]) {
+    int steady_frames = SELFCHECK_DEFAULT_FRAMES;
+    if (argc > 1) {
+        steady_frames = atoi(argv[1]);
+        if (steady_frames <= 0) {
+            fprintf(stderr, "用法: %s [稳态帧数]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    char work_dir[] = "/tmp/alloc_selfcheck.XXXXXX";
+    if (mkdtemp(work_dir) == NULL) {
+        perror("创建临时目录失败");
+        return 1;
+    }
+    char calib_path[64];
+    snprintf(calib_path, sizeof(calib_path), "%s/calib.txt", work_dir);
+
+    // 模块初始化（与主程序相同的接口，参数取全部功能开启）
+    struct RuntimeConfig initial_config;
+    memset(&initial_config, 0, sizeof(initial_config));
+    initial_config.exposure = -1;
+    initial_config.gain = -1;
+    initial_config.ae_target = AE_DEFAULT_TARGET;
+
+    struct FrameBatchConfig batch_config;
+    memset(&batch_config, 0, sizeof(batch_config));
+    batch_config.dir = work_dir;
+    batch_config.width = UVC_WIDTH;
+    batch_config.height = UVC_HEIGHT;
+    batch_config.batch_frames = BATCH_DEFAULT_FRAMES;
+    batch_config.sample_every = BATCH_DEFAULT_EVERY;
+    batch_config.event_trigger = true;
+
+    bool init_ok = ring_logger_init() == 0 &&
+                   control_channel_init(NULL, &initial_config) == 0 &&
+                   network_stream_init(SELFCHECK_TCP_PORT) == 0 &&
+                   http_stream_init(SELFCHECK_HTTP_PORT) == 0 &&
+                   write_calib(calib_path) == 0 &&
+                   geo_remap_init(calib_path, UVC_WIDTH, UVC_HEIGHT) == 0 &&
+                   motion_detect_init(UVC_WIDTH, UVC_HEIGHT, MOTION_DEFAULT_TILE_THRESHOLD) == 0 &&
+                   frame_batch_init(&batch_config) == 0;
+    if (!init_ok) {
+        fprintf(stderr, "自检初始化失败\n");
+        remove_dir(work_dir);
+        return 1;
+    }
+
+    // 回环客户端：TCP 图像流与 HTTP MJPEG 流各一个，使发送路径与有客户端时一致
+    drain_fds[0] = connect_loopback(SELFCHECK_TCP_PORT, NULL);
+    drain_fds[1] = connect_loopback(SELFCHECK_HTTP_PORT, "GET /stream.mjpg HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    drain_running.store(true);
+    pthread_t drain_thread;
+    bool drain_started = pthread_create(&drain_thread, NULL, drain_loop, NULL) == 0;
+
+    static uint8_t image[UVC_WIDTH * UVC_HEIGHT];
+    static uint8_t remap_image[UVC_WIDTH * UVC_HEIGHT];
+    struct AllocCounts counts;
+    struct LumaStats luma;
+    struct MotionResult motion;
+    int failed_frame = -1;
+    uint32_t failed_allocs = 0;
+    uint64_t external_total = 0;
+    int frames_since_sent = 0;
+    int clients = 0;
+    int total_frames = SELFCHECK_WARMUP_FRAMES + steady_frames;
+
+    for (int i = 0; i < total_frames; i++) {
+        alloc_tracker_frame_begin();
+
+        // 以下顺序与 main.cpp 主循环一致（合成图像代替 capture_supervisor_next_frame）
+        control_config_quiescent();
+        const struct RuntimeConfig *cfg = control_config_acquire();
+        render_frame(image, i);
+
+        luma_stats_compute(image, UVC_WIDTH * UVC_HEIGHT, &luma);
+        auto_exposure_update(&luma);
+
+        geo_remap_apply(image, remap_image, (i & 1) ? GEO_INTERP_BILINEAR : GEO_INTERP_NEAREST);
+
+        bool event = false;
+        uint32_t motion_score = 0;
+        if (motion_detect_process(remap_image, &motion) == 0) {
+            event = motion.changed;
+            motion_score = motion.score;
+            if (!motion.changed && frames_since_sent >= UVC_FPS) {
+                motion_detect_set_reference(remap_image);
+            }
+        }
+
+        struct BatchFrameInfo batch_info;
+        batch_info.frame_index = i;
+        batch_info.timestamp_us = monotonic_us();
+        batch_info.event = event;
+        batch_info.motion_score = motion_score;
+        batch_info.luma_mean = luma.mean;
+        frame_batch_submit(remap_image, &batch_info);
+
+        if (event || frames_since_sent >= UVC_FPS) {
+            clients = network_stream_send(remap_image, UVC_WIDTH, UVC_HEIGHT, &luma);
+            http_stream_publish(remap_image, UVC_WIDTH, UVC_HEIGHT, NULL, 0, &luma);
+            clients += http_stream_get_clients();
+            frames_since_sent = 0;
+        } else {
+            frames_since_sent++;
+        }
+        if (i % 30 == 0) {
+            ring_log("自检第%d帧: 亮度 %d, 客户端 %d, 曝光目标 %d\n", i, luma.mean, clients, cfg->ae_target);
+        }
+
+        alloc_tracker_frame_end(&counts);
+        if (i >= SELFCHECK_WARMUP_FRAMES) {
+            external_total += counts.external;
+            if (counts.own > 0) {
+                failed_frame = i - SELFCHECK_WARMUP_FRAMES;
+                failed_allocs = counts.own;
+                break;
+            }
+        }
+        usleep(1000000 / UVC_FPS);
+    }
+
+    drain_running.store(false);
+    if (drain_started) {
+        pthread_join(drain_thread, NULL);
+    }
+    for (int i = 0; i < 2; i++) {
+        if (drain_fds[i] >= 0) {
+            close(drain_fds[i]);
+        }
+    }
+    frame_batch_close();
+    motion_detect_close();
+    geo_remap_close();
+    http_stream_close();
+    network_stream_close();
+    control_channel_close();
+    ring_logger_close();
+
+    uint64_t batches_written = 0, batches_dropped = 0;
+    frame_batch_get_stats(&batches_written, &batches_dropped);
+    remove_dir(work_dir);
+
+    if (failed_frame >= 0) {
+        printf("内存分配自检失败：稳态第%d帧发生 %u 次内存分配\n", failed_frame, failed_allocs);
+        return SELFCHECK_FAIL_EXIT_CODE;
+    }
+    printf("内存分配自检通过：稳态 %d 帧无分配（客户端 %d，写出批文件 %llu，第三方库 %llu 次）\n",
+           steady_frames, clients, (unsigned long long)batches_written,
+           (unsigned long long)external_total);
+    return 0;
+}
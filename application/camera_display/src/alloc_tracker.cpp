@@ -0,0 +1,105 @@
+#include "alloc_tracker.h"
+
+#ifdef CAMERA_ALLOC_TRACKING
+
+#include <stddef.h>
+#include <errno.h>
+
+// glibc 内部分配函数（替换后的 malloc 通过它们完成实际分配）
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+void __libc_free(void *ptr);
+}
+
+// 线程局部计数（initial-exec TLS，malloc 中访问不会再触发分配）
+static __thread bool tracking = false;
+static __thread int external_depth = 0;
+static __thread uint32_t own_allocs = 0;
+static __thread uint32_t external_allocs = 0;
+
+static inline void count_alloc() {
+    if (tracking) {
+        if (external_depth > 0) {
+            external_allocs++;
+        } else {
+            own_allocs++;
+        }
+    }
+}
+
+extern "C" {
+
+void *malloc(size_t size) {
+    count_alloc();
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+    count_alloc();
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+    count_alloc();
+    return __libc_realloc(ptr, size);
+}
+
+void *memalign(size_t alignment, size_t size) {
+    count_alloc();
+    return __libc_memalign(alignment, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+    count_alloc();
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **ptr, size_t alignment, size_t size) {
+    count_alloc();
+    void *p = __libc_memalign(alignment, size);
+    if (p == NULL) {
+        return ENOMEM;
+    }
+    *ptr = p;
+    return 0;
+}
+
+void free(void *ptr) {
+    __libc_free(ptr);
+}
+
+} // extern "C"
+
+void alloc_tracker_frame_begin() {
+    own_allocs = 0;
+    external_allocs = 0;
+    external_depth = 0;
+    tracking = true;
+}
+
+void alloc_tracker_frame_end(struct AllocCounts *counts) {
+    tracking = false;
+    counts->own = own_allocs;
+    counts->external = external_allocs;
+}
+
+void alloc_tracker_external_begin() {
+    external_depth++;
+}
+
+void alloc_tracker_external_end() {
+    if (external_depth > 0) {
+        external_depth--;
+    }
+}
+
+void alloc_tracker_count_own(uint32_t count) {
+    if (tracking) {
+        own_allocs += count;
+    }
+}
+
+#endif // CAMERA_ALLOC_TRACKING
@@ -0,0 +1,296 @@
+#include "auto_exposure.h"
+#include "uvc_camera.h"
+#include "rt_profile.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <linux/videodev2.h>
+#include <atomic>
+
+// 调节线程
+static pthread_t ae_thread;
+static bool thread_started = false;
+static std::atomic<bool> ae_running(false);
+
+// 采集线程 -> 调节线程：最近一次统计的平均亮度，-1 表示尚无新数据
+static std::atomic<int> measured_mean(-1);
+static std::atomic<bool> reapply_pending(false);
+
+// 调节状态（ae_lock 保护，调节线程在持锁期间写入摄像头）
+static pthread_mutex_t ae_lock = PTHREAD_MUTEX_INITIALIZER;
+static int target = 0;
+static bool manual_applied = false;
+static int exposure = 0;
+static int exposure_min = 1;
+static int exposure_cap = 1;
+static bool gain_supported = false;
+static int gain = -1;
+static int gain_min = 0;
+static int gain_max = 0;
+
+// 供统计接口读取（无锁）
+static std::atomic<bool> state_active(false);
+static std::atomic<int> state_exposure(0);
+static std::atomic<int> state_gain(-1);
+
+// ==================== 亮度统计 ====================
+
+void luma_stats_compute(const uint8_t *image, uint32_t pixels, struct LumaStats *stats) {
+    memset(stats, 0, sizeof(*stats));
+    if (image == NULL || pixels == 0) {
+        return;
+    }
+
+    // 直方图无法向量化（SSE2/LSX 均无 scatter）：每次读8字节用移位取出各像素，
+    // 分散到4个子直方图，相邻同值像素不会互相等待同一计数器
+    uint32_t sub[4][256];
+    memset(sub, 0, sizeof(sub));
+    uint32_t i = 0;
+    for (; i + 8 <= pixels; i += 8) {
+        uint64_t w;
+        memcpy(&w, image + i, sizeof(w));
+        sub[0][w & 0xff]++;
+        sub[1][(w >> 8) & 0xff]++;
+        sub[2][(w >> 16) & 0xff]++;
+        sub[3][(w >> 24) & 0xff]++;
+        sub[0][(w >> 32) & 0xff]++;
+        sub[1][(w >> 40) & 0xff]++;
+        sub[2][(w >> 48) & 0xff]++;
+        sub[3][w >> 56]++;
+    }
+    for (; i < pixels; i++) {
+        sub[0][image[i]]++;
+    }
+
+    // 合并并计算分位数；总和由直方图得出，不再单独遍历图像
+    uint64_t sum = 0;
+    const uint32_t p5_count = (pixels * 5 + 99) / 100;
+    const uint32_t p50_count = (pixels + 1) / 2;
+    const uint32_t p95_count = (pixels * 95 + 99) / 100;
+    uint32_t cumulative = 0;
+    bool p5_found = false, p50_found = false, p95_found = false;
+
+    for (int v = 0; v < 256; v++) {
+        uint32_t count = sub[0][v] + sub[1][v] + sub[2][v] + sub[3][v];
+        stats->hist[v * LUMA_HIST_BINS / 256] += count;
+        sum += (uint64_t)count * v;
+        cumulative += count;
+        if (!p5_found && cumulative >= p5_count) {
+            stats->p5 = (uint8_t)v;
+            p5_found = true;
+        }
+        if (!p50_found && cumulative >= p50_count) {
+            stats->p50 = (uint8_t)v;
+            p50_found = true;
+        }
+        if (!p95_found && cumulative >= p95_count) {
+            stats->p95 = (uint8_t)v;
+            p95_found = true;
+        }
+    }
+
+    stats->mean = (uint8_t)(sum / pixels);
+    stats->pixels = pixels;
+}
+
+// ==================== 曝光调节 ====================
+
+static void publish_state() {
+    state_exposure.store(exposure);
+    state_gain.store(gain_supported ? gain : -1);
+}
+
+/**
+ * @brief 切换到手动曝光并写入当前曝光/增益（持有 ae_lock 时调用）
+ */
+static int apply_manual_mode() {
+    // 禁止摄像头为延长曝光而降低帧率（部分摄像头不支持该控制项）
+    uvc_camera_set_control(V4L2_CID_EXPOSURE_AUTO_PRIORITY, 0);
+
+    if (uvc_camera_set_control(V4L2_CID_EXPOSURE_AUTO, V4L2_EXPOSURE_MANUAL) < 0 ||
+        uvc_camera_set_control(V4L2_CID_EXPOSURE_ABSOLUTE, exposure) < 0) {
+        return -1;
+    }
+    if (gain_supported) {
+        uvc_camera_set_control(V4L2_CID_GAIN, gain);
+    }
+    return 0;
+}
+
+/**
+ * @brief 单次调节（持有 ae_lock 时调用）
+ */
+static void adjust_step() {
+    if (!manual_applied || reapply_pending.exchange(false)) {
+        manual_applied = (apply_manual_mode() == 0);
+        measured_mean.store(-1);
+        return;
+    }
+
+    int mean = measured_mean.exchange(-1);
+    if (mean < 0) {
+        return;  // 上次调节后还没有新的统计
+    }
+
+    int error = target - mean;
+    if (error >= -AE_DEADBAND && error <= AE_DEADBAND) {
+        return;
+    }
+
+    // 期望倍率，限制单次调节幅度避免振荡
+    int ratio = (mean > 0) ? target * 256 / mean : AE_MAX_STEP_Q8;
+    if (ratio > AE_MAX_STEP_Q8) ratio = AE_MAX_STEP_Q8;
+    if (ratio < 256 * 256 / AE_MAX_STEP_Q8) ratio = 256 * 256 / AE_MAX_STEP_Q8;
+
+    int new_exposure = exposure;
+    int new_gain = gain;
+    int gain_step = (gain_max - gain_min) / 16;
+    if (gain_step < 1) gain_step = 1;
+
+    if (error > 0) {
+        // 偏暗：先延长曝光（不超过帧周期），再提高增益
+        if (exposure < exposure_cap) {
+            new_exposure = exposure * ratio / 256;
+            if (new_exposure <= exposure) new_exposure = exposure + 1;
+            if (new_exposure > exposure_cap) new_exposure = exposure_cap;
+        } else if (gain_supported && gain < gain_max) {
+            new_gain = gain + gain_step;
+            if (new_gain > gain_max) new_gain = gain_max;
+        }
+    } else {
+        // 偏亮：先降低增益（减少噪声），再缩短曝光
+        if (gain_supported && gain > gain_min) {
+            new_gain = gain - gain_step;
+            if (new_gain < gain_min) new_gain = gain_min;
+        } else if (exposure > exposure_min) {
+            new_exposure = exposure * ratio / 256;
+            if (new_exposure >= exposure) new_exposure = exposure - 1;
+            if (new_exposure < exposure_min) new_exposure = exposure_min;
+        }
+    }
+
+    if (new_exposure != exposure &&
+        uvc_camera_set_control(V4L2_CID_EXPOSURE_ABSOLUTE, new_exposure) == 0) {
+        exposure = new_exposure;
+    }
+    if (new_gain != gain && uvc_camera_set_control(V4L2_CID_GAIN, new_gain) == 0) {
+        gain = new_gain;
+    }
+    publish_state();
+}
+
+static void *ae_loop(void *) {
+    rt_profile_apply_thread(RT_ROLE_PROCESS);
+
+    while (ae_running.load()) {
+        usleep(AE_UPDATE_MS * 1000);
+
+        pthread_mutex_lock(&ae_lock);
+        if (target > 0) {
+            adjust_step();
+        }
+        pthread_mutex_unlock(&ae_lock);
+    }
+    return NULL;
+}
+
+// ==================== 对外接口 ====================
+
+int auto_exposure_init(int fps) {
+    int32_t min_value, max_value;
+
+    if (uvc_camera_query_control(V4L2_CID_EXPOSURE_ABSOLUTE, &min_value, &max_value) < 0) {
+        fprintf(stderr, "摄像头不支持手动曝光，自动曝光不可用\n");
+        return -1;
+    }
+
+    // 曝光上限：一个帧周期（单位100us）
+    exposure_min = min_value > 1 ? min_value : 1;
+    exposure_cap = max_value;
+    if (fps > 0 && 10000 / fps < exposure_cap) {
+        exposure_cap = 10000 / fps;
+    }
+    if (exposure_cap < exposure_min) {
+        exposure_cap = exposure_min;
+    }
+
+    gain_supported = (uvc_camera_query_control(V4L2_CID_GAIN, &min_value, &max_value) == 0 &&
+                      max_value > min_value);
+    if (gain_supported) {
+        gain_min = min_value;
+        gain_max = max_value;
+    }
+
+    target = 0;
+    manual_applied = false;
+    state_active.store(false);
+    measured_mean.store(-1);
+
+    ae_running.store(true);
+    if (pthread_create(&ae_thread, NULL, ae_loop, NULL) != 0) {
+        perror("自动曝光线程创建失败");
+        ae_running.store(false);
+        return -1;
+    }
+    thread_started = true;
+
+    printf("自动曝光可用：曝光 %d-%d（帧周期上限），增益 %s\n",
+           exposure_min, exposure_cap, gain_supported ? "可调" : "不支持");
+    return 0;
+}
+
+int auto_exposure_set_target(int value) {
+    if (!thread_started || value < 0 || value > 255) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&ae_lock);
+    if (value > 0 && target == 0) {
+        // 从摄像头当前值开始调节，避免开启瞬间亮度跳变
+        int32_t current;
+        exposure = exposure_cap;
+        if (uvc_camera_get_control(V4L2_CID_EXPOSURE_ABSOLUTE, &current) == 0) {
+            exposure = current;
+        }
+        if (exposure > exposure_cap) exposure = exposure_cap;
+        if (exposure < exposure_min) exposure = exposure_min;
+
+        gain = gain_min;
+        if (gain_supported && uvc_camera_get_control(V4L2_CID_GAIN, &current) == 0) {
+            gain = current;
+        }
+        manual_applied = false;
+        publish_state();
+    }
+    target = value;
+    state_active.store(value > 0);
+    pthread_mutex_unlock(&ae_lock);
+    return 0;
+}
+
+void auto_exposure_update(const struct LumaStats *stats) {
+    if (stats != NULL && stats->pixels > 0) {
+        measured_mean.store(stats->mean);
+    }
+}
+
+void auto_exposure_reapply() {
+    reapply_pending.store(true);
+}
+
+bool auto_exposure_get_state(int *exposure_out, int *gain_out) {
+    if (exposure_out != NULL) *exposure_out = state_exposure.load();
+    if (gain_out != NULL) *gain_out = state_gain.load();
+    return state_active.load();
+}
+
+void auto_exposure_close() {
+    if (thread_started) {
+        ae_running.store(false);
+        pthread_join(ae_thread, NULL);
+        thread_started = false;
+    }
+    target = 0;
+    state_active.store(false);
+}
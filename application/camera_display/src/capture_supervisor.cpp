@@ -0,0 +1,308 @@
+#include "capture_supervisor.h"
+#include "uvc_camera.h"
+#include "ring_logger.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/inotify.h>
+#include <sys/eventfd.h>
+#include <atomic>
+
+// 内部状态
+static char device[64];
+static char device_dir[64];                // 设备节点所在目录，如 "/dev"
+static const char *device_name = NULL;     // 节点名，如 "video0"
+static bool device_lost = false;
+static int inotify_fd = -1;
+
+// 恢复线程：重新打开设备可能长时间阻塞（USB枚举、格式设置），
+// 在独立线程中进行，采集线程继续按 CAPTURE_NO_SIGNAL_MS 输出"无信号"帧
+static pthread_t recover_thread;
+static bool recover_running = false;            // 仅采集线程访问
+static std::atomic<int> recover_result(0);      // 0:进行中 1:成功 -1:失败
+static int recover_event_fd = -1;               // 恢复线程结束时唤醒采集线程
+
+// 掉线检测：单次读取最长阻塞 UVC_READ_TIMEOUT_MS，距上一帧超过 CAPTURE_NO_SIGNAL_MS 即输出"无信号"帧
+static uint64_t last_frame_ms = 0;
+static int fail_count = 0;                      // 连续读取失败次数
+
+// 掉线统计
+static uint64_t outage_start_ms = 0;
+static uint64_t last_retry_ms = 0;
+static uint32_t last_outage_ms = 0;
+static uint32_t outage_count = 0;
+
+// "无信号"帧
+static uint8_t no_signal_image[UVC_WIDTH * UVC_HEIGHT];
+static uint32_t no_signal_phase = 0;
+
+/**
+ * @brief 获取单调时钟（毫秒）
+ */
+static uint64_t monotonic_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * @brief 生成"无信号"画面：暗背景 + 移动斜条纹，便于观察端确认连接仍然存活
+ */
+static void render_no_signal() {
+    no_signal_phase += 4;
+    for (int y = 0; y < UVC_HEIGHT; y++) {
+        uint8_t *row = no_signal_image + y * UVC_WIDTH;
+        for (int x = 0; x < UVC_WIDTH; x++) {
+            row[x] = (((x + y + no_signal_phase) >> 3) & 1) ? 48 : 16;
+        }
+    }
+    // 中间横条
+    memset(no_signal_image + (UVC_HEIGHT / 2 - 8) * UVC_WIDTH, 128, 16 * UVC_WIDTH);
+}
+
+/**
+ * @brief 监听设备所在目录（通常为 /dev），设备节点重新出现时唤醒
+ */
+static void start_device_watch() {
+    if (inotify_fd >= 0) {
+        return;
+    }
+
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd < 0) {
+        perror("inotify初始化失败，改为周期性重试");
+        return;
+    }
+
+    if (inotify_add_watch(inotify_fd, device_dir, IN_CREATE | IN_ATTRIB | IN_MOVED_TO) < 0) {
+        perror("inotify监听设备目录失败，改为周期性重试");
+        close(inotify_fd);
+        inotify_fd = -1;
+    }
+}
+
+static void stop_device_watch() {
+    if (inotify_fd >= 0) {
+        close(inotify_fd);
+        inotify_fd = -1;
+    }
+}
+
+/**
+ * @brief 等待设备节点事件或恢复线程结束
+ * @param timeout_ms 最长等待时间
+ * @return true: 目标设备节点有变化
+ */
+static bool wait_device_event(int timeout_ms) {
+    // fd 为 -1 的项被 poll 忽略；两者都不可用时 poll 仅用于延时
+    struct pollfd pfds[2];
+    pfds[0].fd = inotify_fd;
+    pfds[0].events = POLLIN;
+    pfds[0].revents = 0;
+    pfds[1].fd = recover_event_fd;
+    pfds[1].events = POLLIN;
+    pfds[1].revents = 0;
+    if (poll(pfds, 2, timeout_ms) <= 0 || !(pfds[0].revents & POLLIN)) {
+        return false;
+    }
+
+    bool matched = false;
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t len;
+    while ((len = read(inotify_fd, buf, sizeof(buf))) > 0) {
+        for (char *p = buf; p < buf + len; ) {
+            struct inotify_event *ev = (struct inotify_event *)p;
+            if (ev->len > 0 && strcmp(ev->name, device_name) == 0) {
+                matched = true;
+            }
+            p += sizeof(struct inotify_event) + ev->len;
+        }
+    }
+    return matched;
+}
+
+static void enter_lost_state() {
+    device_lost = true;
+    outage_start_ms = last_frame_ms;           // 中断从最后一帧正常图像算起
+    last_retry_ms = monotonic_ms();
+    outage_count++;
+
+    uvc_camera_close();
+    start_device_watch();
+
+    ring_log_error("警告：摄像头掉线（第%u次），输出无信号画面并等待设备恢复...\n", outage_count);
+}
+
+/**
+ * @brief 尝试以上次的格式重新打开设备并读取一帧
+ */
+static int try_recover() {
+    // udev 创建节点后可能稍后才设置权限
+    if (access(device, R_OK | W_OK) != 0) {
+        return -1;
+    }
+    if (uvc_camera_reopen() < 0) {
+        return -1;
+    }
+    if (wait_image_refresh() < 0) {
+        uvc_camera_close();
+        return -1;
+    }
+    return 0;
+}
+
+static void *recover_loop(void *) {
+    recover_result.store(try_recover() == 0 ? 1 : -1);
+    // 唤醒采集线程；写入失败时采集线程在下一个无信号间隔检查结果
+    uint64_t one = 1;
+    ssize_t ret = write(recover_event_fd, &one, sizeof(one));
+    (void)ret;
+    return NULL;
+}
+
+/**
+ * @brief 在恢复线程中尝试重新打开设备
+ */
+static void start_recover() {
+    recover_result.store(0);
+    recover_running = pthread_create(&recover_thread, NULL, recover_loop, NULL) == 0;
+    if (!recover_running) {
+        // 无法创建线程时退回到在采集线程中直接尝试
+        recover_result.store(try_recover() == 0 ? 1 : -1);
+    }
+}
+
+/**
+ * @brief 检查恢复结果（不阻塞）
+ * @return 1:已恢复 0:进行中 -1:本次失败或未在恢复
+ */
+static int poll_recover() {
+    int result = recover_result.load();
+    if (result == 0) {
+        return recover_running ? 0 : -1;
+    }
+    if (recover_running) {
+        pthread_join(recover_thread, NULL);
+        recover_running = false;
+    }
+    // 清除唤醒计数
+    if (recover_event_fd >= 0) {
+        uint64_t value;
+        ssize_t ret = read(recover_event_fd, &value, sizeof(value));
+        (void)ret;
+    }
+    recover_result.store(0);
+    return result;
+}
+
+int capture_supervisor_init(const char *device_path) {
+    strncpy(device, device_path, sizeof(device) - 1);
+    device[sizeof(device) - 1] = '\0';
+
+    const char *slash = strrchr(device, '/');
+    device_name = slash ? slash + 1 : device;
+    if (slash != NULL && slash != device) {
+        size_t dir_len = slash - device;
+        memcpy(device_dir, device, dir_len);
+        device_dir[dir_len] = '\0';
+    } else {
+        strcpy(device_dir, slash ? "/" : ".");
+    }
+
+    device_lost = false;
+    last_outage_ms = 0;
+    outage_count = 0;
+    fail_count = 0;
+    last_frame_ms = monotonic_ms();
+    render_no_signal();
+
+    if (recover_event_fd < 0) {
+        recover_event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    }
+
+    return uvc_camera_init(device);
+}
+
+enum CaptureStatus capture_supervisor_next_frame(uint8_t **image) {
+    bool lost_now = false;
+    while (!device_lost) {
+        if (wait_image_refresh() == 0 && get_gray_image() != NULL) {
+            fail_count = 0;
+            last_frame_ms = monotonic_ms();
+            *image = get_gray_image();
+            return CAPTURE_OK;
+        }
+        fail_count++;
+        // 设备节点已消失或连续失败达到上限：判定掉线，转入恢复
+        if (access(device, F_OK) != 0 || fail_count >= CAPTURE_FAIL_LIMIT) {
+            enter_lost_state();
+            lost_now = true;
+            break;
+        }
+        // 偶发的读取/解码失败立即重试；距上一帧已超过无信号间隔时先输出"无信号"帧，画面与统计不中断
+        if (monotonic_ms() - last_frame_ms >= CAPTURE_NO_SIGNAL_MS) {
+            render_no_signal();
+            *image = no_signal_image;
+            return CAPTURE_NO_SIGNAL;
+        }
+    }
+
+    // 等待设备事件，最长一个"无信号"帧间隔（刚判定掉线时本次读取已经等待过，直接输出）
+    bool event = lost_now ? false : wait_device_event(CAPTURE_NO_SIGNAL_MS);
+    uint64_t now = monotonic_ms();
+
+    if (!recover_running && (event || now - last_retry_ms >= CAPTURE_RETRY_MS)) {
+        last_retry_ms = now;
+        start_recover();
+    }
+
+    if (poll_recover() > 0) {
+        device_lost = false;
+        fail_count = 0;
+        last_frame_ms = monotonic_ms();
+        stop_device_watch();
+        last_outage_ms = (uint32_t)(monotonic_ms() - outage_start_ms);
+        ring_log("摄像头已恢复，中断时长: %u ms\n", last_outage_ms);
+        *image = get_gray_image();
+        return CAPTURE_RECOVERED;
+    }
+
+    render_no_signal();
+    *image = no_signal_image;
+    return CAPTURE_NO_SIGNAL;
+}
+
+uint32_t capture_supervisor_last_outage_ms() {
+    if (device_lost) {
+        return (uint32_t)(monotonic_ms() - outage_start_ms);
+    }
+    if (fail_count > 0) {
+        // 尚未判定掉线，但已停止出图
+        return (uint32_t)(monotonic_ms() - last_frame_ms);
+    }
+    return last_outage_ms;
+}
+
+uint32_t capture_supervisor_outage_count() {
+    return outage_count;
+}
+
+void capture_supervisor_close() {
+    // 等待进行中的恢复尝试结束（最长为一次 V4L2 读超时）
+    if (recover_running) {
+        pthread_join(recover_thread, NULL);
+        recover_running = false;
+    }
+    recover_result.store(0);
+    if (recover_event_fd >= 0) {
+        close(recover_event_fd);
+        recover_event_fd = -1;
+    }
+    stop_device_watch();
+    uvc_camera_close();
+    device_lost = false;
+}
@@ -0,0 +1,453 @@
+#include "control_channel.h"
+#include "uvc_camera.h"
+#include "auto_exposure.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <limits.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <linux/videodev2.h>
+#include <atomic>
+
+// 配置快照池：采集线程可能仍在读取旧快照，宽限期过后才复用
+#define CONTROL_SNAPSHOTS     4
+#define CONTROL_LINE_MAX      256
+#define CONTROL_RETRY_MS      1         // 有待发布配置时的重试间隔
+
+/*
+ * 发布方式（RCU）：
+ *   - 控制线程是唯一写者：复制当前快照 -> 修改 -> 原子替换指针
+ *   - 采集线程每次循环 acquire 一次指针，循环结束调用 quiescent 使 reader_epoch 加1
+ *   - 被替换的快照记录替换时的 reader_epoch，只有 reader_epoch 增长后才可复用
+ * 采集线程只有原子读写，不会等待锁。
+ */
+static RuntimeConfig snapshots[CONTROL_SNAPSHOTS];
+static uint64_t snapshot_retired_at[CONTROL_SNAPSHOTS];
+static std::atomic<const RuntimeConfig *> current_config(NULL);
+static std::atomic<uint64_t> reader_epoch(1);
+
+// 控制线程状态
+struct ControlClient {
+    int fd;
+    char line[CONTROL_LINE_MAX];
+    size_t len;
+};
+
+static int listen_fd = -1;
+static char socket_path_buf[108];
+static pthread_t control_thread;
+static bool thread_started = false;
+static std::atomic<bool> channel_running(false);
+static ControlClient control_clients[CONTROL_MAX_CLIENTS];
+
+// 暂无可复用快照时保存的待发布配置（仅控制线程访问），由控制线程循环重试
+static RuntimeConfig pending_config;
+static bool config_pending = false;
+
+/**
+ * @brief 发布新配置（仅控制线程/初始化时调用，不等待）
+ * @return 0:已发布 1:旧快照均未过宽限期，需稍后重试
+ */
+static int publish_config(const RuntimeConfig *config) {
+    const RuntimeConfig *old = current_config.load();
+    uint64_t epoch = reader_epoch.load();
+    int slot = -1;
+
+    for (int i = 0; i < CONTROL_SNAPSHOTS; i++) {
+        if (&snapshots[i] != old && snapshot_retired_at[i] < epoch) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot < 0) {
+        return 1;
+    }
+
+    snapshots[slot] = *config;
+    snapshots[slot].generation = old ? old->generation + 1 : 1;
+    current_config.store(&snapshots[slot]);
+
+    if (old != NULL) {
+        snapshot_retired_at[old - snapshots] = reader_epoch.load();
+    }
+    return 0;
+}
+
+const struct RuntimeConfig *control_config_acquire() {
+    return current_config.load();
+}
+
+void control_config_quiescent() {
+    reader_epoch.fetch_add(1);
+}
+
+// ==================== 摄像头控制 ====================
+
+static int apply_exposure(int exposure) {
+    if (exposure < 0) {
+        return uvc_camera_set_control(V4L2_CID_EXPOSURE_AUTO, V4L2_EXPOSURE_APERTURE_PRIORITY);
+    }
+    if (uvc_camera_set_control(V4L2_CID_EXPOSURE_AUTO, V4L2_EXPOSURE_MANUAL) < 0) {
+        return -1;
+    }
+    return uvc_camera_set_control(V4L2_CID_EXPOSURE_ABSOLUTE, exposure);
+}
+
+/**
+ * @brief 解析整数参数（整个参数为十进制整数且在范围内）
+ * @return 0:成功 -1:格式或范围错误
+ */
+static int parse_int(const char *text, long min, long max, int *value) {
+    char *end = NULL;
+    errno = 0;
+    long v = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || errno == ERANGE || v < min || v > max) {
+        return -1;
+    }
+    *value = (int)v;
+    return 0;
+}
+
+/**
+ * @brief 解析 V4L2 控制项的值，摄像头提供取值范围时按范围检查
+ * @return 0:成功 -1:格式或范围错误（min/max 输出允许的范围，摄像头未提供时为 0..INT_MAX）
+ */
+static int parse_control_value(uint32_t id, const char *text, int *value, int32_t *min, int32_t *max) {
+    if (uvc_camera_query_control(id, min, max) < 0) {
+        *min = 0;
+        *max = INT_MAX;
+    }
+    return parse_int(text, *min, *max, value);
+}
+
+void control_channel_apply_camera() {
+    const RuntimeConfig *config = current_config.load();
+    if (config == NULL) {
+        return;
+    }
+    if (config->ae_target > 0) {
+        auto_exposure_reapply();
+        return;
+    }
+    if (config->exposure >= 0) {
+        apply_exposure(config->exposure);
+    }
+    if (config->gain >= 0) {
+        uvc_camera_set_control(V4L2_CID_GAIN, config->gain);
+    }
+}
+
+// ==================== 命令处理 ====================
+
+static void reply(int fd, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+static void reply(int fd, const char *fmt, ...) {
+    char buf[512];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    if (n > 0) {
+        if (n >= (int)sizeof(buf)) n = sizeof(buf) - 1;
+        // 发送失败说明客户端已断开，由poll检测并关闭
+        send(fd, buf, n, MSG_NOSIGNAL);
+    }
+}
+
+/**
+ * @brief 重试发布待发布配置
+ */
+static void publish_pending() {
+    if (config_pending && publish_config(&pending_config) == 0) {
+        config_pending = false;
+    }
+}
+
+static void handle_command(int fd, char *line) {
+    // 有待发布配置时以其为准，连续命令的修改不会丢失
+    const RuntimeConfig *cur = config_pending ? &pending_config : current_config.load();
+    RuntimeConfig next = *cur;
+    char cmd[32] = {0};
+    char arg[32] = {0};
+    int n = sscanf(line, "%31s %31s", cmd, arg);
+
+    if (n < 1) {
+        return;
+    }
+
+    if (strcmp(cmd, "get") == 0) {
+        // 显示已生效的快照
+        const RuntimeConfig *live = current_config.load();
+        reply(fd, "OK generation=%u display=%s fps_cap=%d roi=%u,%u,%u,%u encoding=%s exposure=%d gain=%d ae=%d%s\n",
+              live->generation, live->display_enabled ? "on" : "off", live->fps_cap,
+              live->roi_x, live->roi_y, live->roi_w, live->roi_h,
+              live->ws_jpeg ? "jpeg" : "gray", live->exposure, live->gain, live->ae_target,
+              config_pending ? " pending" : "");
+        return;
+    } else if (strcmp(cmd, "ae") == 0 && n == 2) {
+        int value = 0;
+        if (strcmp(arg, "off") != 0 && parse_int(arg, 1, 255, &value) < 0) {
+            reply(fd, "ERR 用法: ae <目标亮度 1-255> | ae off\n");
+            return;
+        }
+        if (auto_exposure_set_target(value) < 0) {
+            reply(fd, "ERR 自动曝光不可用\n");
+            return;
+        }
+        next.ae_target = value;
+    } else if (strcmp(cmd, "exposure") == 0 && n == 2) {
+        int value = -1;
+        int32_t min, max;
+        if (strcmp(arg, "auto") != 0 &&
+            parse_control_value(V4L2_CID_EXPOSURE_ABSOLUTE, arg, &value, &min, &max) < 0) {
+            if (max == INT_MAX) {
+                reply(fd, "ERR 用法: exposure <非负整数> | exposure auto\n");
+            } else {
+                reply(fd, "ERR 用法: exposure <%d-%d> | exposure auto\n", min, max);
+            }
+            return;
+        }
+        // 手动曝光：先停止板上自动曝光，避免被调节线程覆盖
+        auto_exposure_set_target(0);
+        next.ae_target = 0;
+        next.exposure = value;
+        if (apply_exposure(next.exposure) < 0) {
+            reply(fd, "ERR 摄像头不支持该曝光设置\n");
+            return;
+        }
+    } else if (strcmp(cmd, "gain") == 0 && n == 2) {
+        int value;
+        int32_t min, max;
+        if (parse_control_value(V4L2_CID_GAIN, arg, &value, &min, &max) < 0) {
+            if (max == INT_MAX) {
+                reply(fd, "ERR 用法: gain <非负整数>\n");
+            } else {
+                reply(fd, "ERR 用法: gain <%d-%d>\n", min, max);
+            }
+            return;
+        }
+        auto_exposure_set_target(0);
+        next.ae_target = 0;
+        next.gain = value;
+        if (uvc_camera_set_control(V4L2_CID_GAIN, next.gain) < 0) {
+            reply(fd, "ERR 摄像头不支持该增益设置\n");
+            return;
+        }
+    } else if (strcmp(cmd, "roi") == 0 && n == 2 && strcmp(arg, "off") == 0) {
+        next.roi_x = next.roi_y = next.roi_w = next.roi_h = 0;
+    } else if (strcmp(cmd, "roi") == 0) {
+        int x, y, w, h;
+        if (sscanf(line, "%*s %d %d %d %d", &x, &y, &w, &h) != 4 ||
+            x < 0 || y < 0 || w <= 0 || h <= 0 ||
+            x + w > UVC_WIDTH || y + h > UVC_HEIGHT) {
+            reply(fd, "ERR 用法: roi <x> <y> <w> <h>（范围 %dx%d）| roi off\n", UVC_WIDTH, UVC_HEIGHT);
+            return;
+        }
+        next.roi_x = x;
+        next.roi_y = y;
+        next.roi_w = w;
+        next.roi_h = h;
+    } else if (strcmp(cmd, "encoding") == 0 && n == 2 &&
+               (strcmp(arg, "gray") == 0 || strcmp(arg, "jpeg") == 0)) {
+        next.ws_jpeg = (strcmp(arg, "jpeg") == 0);
+    } else if (strcmp(cmd, "display") == 0 && n == 2 &&
+               (strcmp(arg, "on") == 0 || strcmp(arg, "off") == 0)) {
+        next.display_enabled = (strcmp(arg, "on") == 0);
+    } else if (strcmp(cmd, "fps") == 0 && n == 2) {
+        int value;
+        if (parse_int(arg, 0, UVC_FPS, &value) < 0) {
+            reply(fd, "ERR 用法: fps <0-%d>（0：不限制）\n", UVC_FPS);
+            return;
+        }
+        next.fps_cap = value;
+    } else {
+        reply(fd, "ERR 未知命令。可用: get | exposure <值|auto> | gain <值> | ae <目标>|off | "
+                  "roi <x> <y> <w> <h>|off | encoding gray|jpeg | display on|off | fps <N>\n");
+        return;
+    }
+
+    if (publish_config(&next) != 0) {
+        // 采集线程仍持有旧快照：暂存，由控制线程在宽限期过后发布
+        pending_config = next;
+        config_pending = true;
+        reply(fd, "OK pending\n");
+        return;
+    }
+    config_pending = false;
+    reply(fd, "OK generation=%u\n", current_config.load()->generation);
+}
+
+static void close_control_client(int index) {
+    if (control_clients[index].fd >= 0) {
+        close(control_clients[index].fd);
+        control_clients[index].fd = -1;
+        control_clients[index].len = 0;
+    }
+}
+
+static void on_client_data(int index) {
+    ControlClient *client = &control_clients[index];
+    ssize_t n = recv(client->fd, client->line + client->len,
+                     CONTROL_LINE_MAX - 1 - client->len, 0);
+    if (n <= 0) {
+        close_control_client(index);
+        return;
+    }
+    client->len += n;
+    client->line[client->len] = '\0';
+
+    // 逐行处理
+    char *start = client->line;
+    char *newline;
+    while ((newline = strchr(start, '\n')) != NULL) {
+        *newline = '\0';
+        if (newline > start && newline[-1] == '\r') newline[-1] = '\0';
+        handle_command(client->fd, start);
+        start = newline + 1;
+    }
+
+    size_t remain = client->len - (start - client->line);
+    if (remain >= CONTROL_LINE_MAX - 1) {
+        reply(client->fd, "ERR 命令过长\n");
+        remain = 0;
+    }
+    memmove(client->line, start, remain);
+    client->len = remain;
+}
+
+static void *control_loop(void *) {
+    struct pollfd pfds[CONTROL_MAX_CLIENTS + 1];
+
+    while (channel_running.load()) {
+        publish_pending();
+
+        int count = 0;
+        pfds[count].fd = listen_fd;
+        pfds[count].events = POLLIN;
+        count++;
+        for (int i = 0; i < CONTROL_MAX_CLIENTS; i++) {
+            pfds[count].fd = control_clients[i].fd;     // fd为-1时poll忽略
+            pfds[count].events = POLLIN;
+            count++;
+        }
+
+        int ready = poll(pfds, count, config_pending ? CONTROL_RETRY_MS : 500);
+        if (ready <= 0) {
+            continue;
+        }
+
+        if (pfds[0].revents & POLLIN) {
+            int fd = accept(listen_fd, NULL, NULL);
+            if (fd >= 0) {
+                int index = -1;
+                for (int i = 0; i < CONTROL_MAX_CLIENTS; i++) {
+                    if (control_clients[i].fd < 0) {
+                        index = i;
+                        break;
+                    }
+                }
+                if (index < 0) {
+                    reply(fd, "ERR 连接数已满\n");
+                    close(fd);
+                } else {
+                    control_clients[index].fd = fd;
+                    control_clients[index].len = 0;
+                }
+            }
+        }
+
+        for (int i = 0; i < CONTROL_MAX_CLIENTS; i++) {
+            if (control_clients[i].fd >= 0 && (pfds[i + 1].revents & (POLLIN | POLLHUP | POLLERR))) {
+                on_client_data(i);
+            }
+        }
+    }
+
+    return NULL;
+}
+
+// ==================== 对外接口 ====================
+
+int control_channel_init(const char *socket_path, const struct RuntimeConfig *initial) {
+    for (int i = 0; i < CONTROL_SNAPSHOTS; i++) {
+        snapshot_retired_at[i] = 0;
+    }
+    for (int i = 0; i < CONTROL_MAX_CLIENTS; i++) {
+        control_clients[i].fd = -1;
+        control_clients[i].len = 0;
+    }
+    current_config.store(NULL);
+    config_pending = false;
+    publish_config(initial);     // 快照池全部空闲，必定成功
+
+    if (socket_path == NULL) {
+        return 0;
+    }
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "控制通道路径过长: %s\n", socket_path);
+        return -1;
+    }
+    strcpy(addr.sun_path, socket_path);
+    strcpy(socket_path_buf, socket_path);
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0) {
+        perror("控制通道socket创建失败");
+        return -1;
+    }
+
+    // 删除上次异常退出残留的socket文件；listen 之前收紧权限，其他用户无法连接修改摄像头设置
+    unlink(socket_path);
+    if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        chmod(socket_path, CONTROL_SOCKET_MODE) < 0 ||
+        listen(listen_fd, CONTROL_MAX_CLIENTS) < 0) {
+        perror("控制通道bind/listen失败");
+        close(listen_fd);
+        listen_fd = -1;
+        unlink(socket_path);
+        return -1;
+    }
+
+    channel_running.store(true);
+    if (pthread_create(&control_thread, NULL, control_loop, NULL) != 0) {
+        perror("控制线程创建失败");
+        channel_running.store(false);
+        control_channel_close();
+        return -1;
+    }
+    thread_started = true;
+
+    printf("控制通道已启动: %s\n", socket_path);
+    return 0;
+}
+
+void control_channel_close() {
+    if (thread_started) {
+        channel_running.store(false);
+        pthread_join(control_thread, NULL);
+        thread_started = false;
+    }
+
+    for (int i = 0; i < CONTROL_MAX_CLIENTS; i++) {
+        close_control_client(i);
+    }
+
+    if (listen_fd >= 0) {
+        close(listen_fd);
+        listen_fd = -1;
+        unlink(socket_path_buf);
+        printf("控制通道已关闭\n");
+    }
+}
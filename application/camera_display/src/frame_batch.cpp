@@ -0,0 +1,432 @@
+#include "frame_batch.h"
+#include "rt_profile.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <atomic>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#define BATCH_BUFFERS   2               // 双缓冲：采集线程填充一个，写盘线程写出另一个
+#define BATCH_PATH_MAX  512
+
+static_assert(sizeof(BatchFileHeader) == 64, "BatchFileHeader 必须为64字节");
+static_assert(sizeof(BatchFrameMeta) == 32, "BatchFrameMeta 必须为32字节");
+
+// 一批的完整文件内容（头部 + 元数据 + 帧数据），直接一次写出
+// ready 为 false 时缓冲归采集线程填充；采集线程置位（release）后归写盘线程，写完清除后交还
+struct BatchBuffer {
+    uint8_t *data;
+    uint32_t count;
+    uint64_t sequence;
+    std::atomic<bool> ready;            // 已满，等待写盘线程处理
+};
+
+// 参数与布局
+static FrameBatchConfig config;
+static char batch_dir[BATCH_PATH_MAX];
+static size_t frame_size = 0;
+static size_t frame_stride = 0;
+static size_t data_offset = 0;
+static size_t buffer_size = 0;
+
+// 缓冲（启动时分配，运行中不再分配）
+static BatchBuffer buffers[BATCH_BUFFERS];
+static int filling = 0;
+static uint64_t next_sequence = 0;
+#ifdef HAVE_ZLIB
+static uint8_t *compress_buffer = NULL;
+static size_t compress_buffer_size = 0;
+#endif
+
+// 事件触发：环形保存最近几帧，事件开始时补入批中
+static uint8_t *preroll_data = NULL;
+static BatchFrameMeta preroll_meta[BATCH_PREROLL_FRAMES];
+static int preroll_head = 0;
+static int preroll_count = 0;
+static bool in_event = false;
+static int postroll_remaining = 0;
+
+// 写盘线程（采集线程交出缓冲后写 eventfd 唤醒，不加锁）
+static int wake_fd = -1;
+static pthread_t writer_thread;
+static bool thread_started = false;
+static std::atomic<bool> writer_running(false);
+static std::atomic<uint64_t> batches_written(0);
+static std::atomic<uint64_t> batches_dropped(0);
+
+static size_t align_up(size_t value) {
+    return (value + BATCH_ALIGN - 1) & ~(size_t)(BATCH_ALIGN - 1);
+}
+
+// ==================== 写盘（写盘线程） ====================
+
+/**
+ * @brief 填写文件头，可选压缩，一次 write() 写出整批
+ */
+static int write_batch(BatchBuffer *buffer) {
+    // 未满的最后一批：清除上一轮留在 count 之后的元数据
+    BatchFrameMeta *metas = (BatchFrameMeta *)(buffer->data + sizeof(BatchFileHeader));
+    memset(metas + buffer->count, 0, (config.batch_frames - buffer->count) * sizeof(BatchFrameMeta));
+
+    BatchFileHeader *header = (BatchFileHeader *)buffer->data;
+    memset(header, 0, sizeof(*header));
+    header->magic = BATCH_MAGIC;
+    header->version = BATCH_VERSION;
+    header->header_size = sizeof(BatchFileHeader);
+    header->frame_count = buffer->count;
+    header->width = config.width;
+    header->height = config.height;
+    header->frame_stride = (uint32_t)frame_stride;
+    header->meta_offset = sizeof(BatchFileHeader);
+    header->data_offset = (uint32_t)data_offset;
+    header->batch_sequence = buffer->sequence;
+    header->raw_size = (uint32_t)(data_offset + buffer->count * frame_stride);
+    header->payload_size = header->raw_size - sizeof(BatchFileHeader);
+
+    const uint8_t *out = buffer->data;
+    size_t out_len = header->raw_size;
+
+#ifdef HAVE_ZLIB
+    if (compress_buffer != NULL) {
+        uLongf zlen = compress_buffer_size - sizeof(BatchFileHeader);
+        if (compress2(compress_buffer + sizeof(BatchFileHeader), &zlen,
+                      buffer->data + sizeof(BatchFileHeader), header->payload_size,
+                      Z_BEST_SPEED) == Z_OK) {
+            header->flags |= BATCH_FLAG_ZLIB;
+            header->payload_size = (uint32_t)zlen;
+            memcpy(compress_buffer, header, sizeof(BatchFileHeader));
+            out = compress_buffer;
+            out_len = sizeof(BatchFileHeader) + zlen;
+        }
+    }
+#endif
+
+    char final_path[BATCH_PATH_MAX + 32];
+    char part_path[sizeof(final_path) + 8];
+    int len = snprintf(final_path, sizeof(final_path), "%s/batch_%06llu.fbat",
+                       batch_dir, (unsigned long long)buffer->sequence);
+    if (len < 0 || len >= (int)sizeof(final_path) ||
+        snprintf(part_path, sizeof(part_path), "%s.part", final_path) >= (int)sizeof(part_path)) {
+        fprintf(stderr, "批文件路径过长: %s\n", batch_dir);
+        return -1;
+    }
+
+    int fd = open(part_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "批文件创建失败 %s: %s\n", part_path, strerror(errno));
+        return -1;
+    }
+
+    // 常规文件一次写完；被信号打断或磁盘接近写满时才会分多次
+    size_t written = 0;
+    while (written < out_len) {
+        ssize_t n = write(fd, out + written, out_len - written);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            fprintf(stderr, "批文件写入失败 %s: %s\n", part_path, strerror(errno));
+            close(fd);
+            unlink(part_path);
+            return -1;
+        }
+        written += n;
+    }
+    close(fd);
+
+    // 写完后再改名，读取端不会看到不完整的文件
+    if (rename(part_path, final_path) < 0) {
+        fprintf(stderr, "批文件重命名失败 %s: %s\n", final_path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief 取序号最小的待写批
+ */
+static BatchBuffer *next_ready_buffer() {
+    BatchBuffer *next = NULL;
+    for (int i = 0; i < BATCH_BUFFERS; i++) {
+        if (buffers[i].ready.load(std::memory_order_acquire) &&
+            (next == NULL || buffers[i].sequence < next->sequence)) {
+            next = &buffers[i];
+        }
+    }
+    return next;
+}
+
+static void *writer_loop(void *) {
+    rt_profile_apply_thread(RT_ROLE_PROCESS);
+
+    while (true) {
+        BatchBuffer *buffer = next_ready_buffer();
+        if (buffer == NULL) {
+            if (!writer_running.load(std::memory_order_acquire)) {
+                break;
+            }
+            // 计数在唤醒前已累加，先检查后等待也不会漏掉交出的批
+            uint64_t value;
+            if (read(wake_fd, &value, sizeof(value)) < 0 && errno != EINTR) {
+                perror("批量写盘线程等待失败");
+                break;
+            }
+            continue;
+        }
+
+        if (write_batch(buffer) == 0) {
+            batches_written.fetch_add(1);
+        } else {
+            batches_dropped.fetch_add(1);
+        }
+
+        buffer->count = 0;
+        buffer->ready.store(false, std::memory_order_release);
+    }
+    return NULL;
+}
+
+// ==================== 帧选择（采集线程） ====================
+
+/**
+ * @brief 唤醒写盘线程
+ */
+static void wake_writer() {
+    uint64_t one = 1;
+    if (write(wake_fd, &one, sizeof(one)) < 0) {
+        perror("批量写盘线程唤醒失败");
+    }
+}
+
+/**
+ * @brief 当前批已满：交给写盘线程，切换到另一个缓冲（无锁，仅原子置位与一次 eventfd 写入）
+ */
+static void hand_off() {
+    int other = (filling + 1) % BATCH_BUFFERS;
+    if (buffers[other].ready.load(std::memory_order_acquire)) {
+        // 写盘线程仍在处理上一批：丢弃本批，采集线程不等待
+        buffers[filling].count = 0;
+        batches_dropped.fetch_add(1);
+        return;
+    }
+    buffers[filling].sequence = next_sequence++;
+    buffers[filling].ready.store(true, std::memory_order_release);
+    filling = other;
+    wake_writer();
+}
+
+static void append_frame(const uint8_t *image, const BatchFrameMeta *meta) {
+    BatchBuffer *buffer = &buffers[filling];
+    BatchFrameMeta *metas = (BatchFrameMeta *)(buffer->data + sizeof(BatchFileHeader));
+
+    memcpy(buffer->data + data_offset + buffer->count * frame_stride, image, frame_size);
+    metas[buffer->count] = *meta;
+    buffer->count++;
+
+    if ((int)buffer->count >= config.batch_frames) {
+        hand_off();
+    }
+}
+
+static void push_preroll(const uint8_t *image, const BatchFrameMeta *meta) {
+    memcpy(preroll_data + preroll_head * frame_size, image, frame_size);
+    preroll_meta[preroll_head] = *meta;
+    preroll_head = (preroll_head + 1) % BATCH_PREROLL_FRAMES;
+    if (preroll_count < BATCH_PREROLL_FRAMES) {
+        preroll_count++;
+    }
+}
+
+static void flush_preroll() {
+    int start = (preroll_head - preroll_count + BATCH_PREROLL_FRAMES) % BATCH_PREROLL_FRAMES;
+    for (int i = 0; i < preroll_count; i++) {
+        int index = (start + i) % BATCH_PREROLL_FRAMES;
+        preroll_meta[index].reason = BATCH_REASON_PREROLL;
+        append_frame(preroll_data + index * frame_size, &preroll_meta[index]);
+    }
+    preroll_count = 0;
+}
+
+void frame_batch_submit(const uint8_t *image, const struct BatchFrameInfo *info) {
+    if (!thread_started || image == NULL) {
+        return;
+    }
+
+    BatchFrameMeta meta;
+    memset(&meta, 0, sizeof(meta));
+    meta.frame_index = info->frame_index;
+    meta.timestamp_us = info->timestamp_us;
+    meta.motion_score = info->motion_score;
+    meta.luma_mean = info->luma_mean;
+
+    if (config.event_trigger) {
+        if (info->event) {
+            // 事件开始：先补入事件前的帧
+            if (!in_event) {
+                flush_preroll();
+                in_event = true;
+            }
+            postroll_remaining = BATCH_POSTROLL_FRAMES;
+            meta.reason = BATCH_REASON_EVENT;
+            append_frame(image, &meta);
+            return;
+        }
+        if (in_event && postroll_remaining > 0) {
+            postroll_remaining--;
+            meta.reason = BATCH_REASON_EVENT;
+            append_frame(image, &meta);
+            return;
+        }
+        in_event = false;
+    }
+
+    if (config.sample_every > 0 && info->frame_index % config.sample_every == 0) {
+        meta.reason = BATCH_REASON_SAMPLE;
+        append_frame(image, &meta);
+        return;
+    }
+
+    if (config.event_trigger) {
+        push_preroll(image, &meta);
+    }
+}
+
+// ==================== 对外接口 ====================
+
+int frame_batch_init(const struct FrameBatchConfig *cfg) {
+    if (cfg->dir == NULL || cfg->width == 0 || cfg->height == 0 ||
+        cfg->batch_frames <= 0 || cfg->batch_frames > BATCH_MAX_FRAMES) {
+        fprintf(stderr, "批量采集参数错误（每批帧数需在 1-%d 之间）\n", BATCH_MAX_FRAMES);
+        return -1;
+    }
+    if (strlen(cfg->dir) >= BATCH_PATH_MAX || access(cfg->dir, W_OK) != 0) {
+        fprintf(stderr, "批量采集目录不可写: %s\n", cfg->dir);
+        return -1;
+    }
+
+    frame_batch_close();
+
+    config = *cfg;
+    strcpy(batch_dir, cfg->dir);
+    config.dir = batch_dir;
+
+    frame_size = (size_t)cfg->width * cfg->height;
+    frame_stride = align_up(frame_size);
+    data_offset = align_up(sizeof(BatchFileHeader) + cfg->batch_frames * sizeof(BatchFrameMeta));
+    buffer_size = data_offset + cfg->batch_frames * frame_stride;
+
+    // 分配并清零（同时预先触发缺页），帧之间的对齐填充保持为0
+    for (int i = 0; i < BATCH_BUFFERS; i++) {
+        void *ptr = NULL;
+        if (posix_memalign(&ptr, BATCH_ALIGN, buffer_size) != 0) {
+            perror("批缓冲分配失败");
+            frame_batch_close();
+            return -1;
+        }
+        memset(ptr, 0, buffer_size);
+        buffers[i].data = (uint8_t *)ptr;
+        buffers[i].count = 0;
+        buffers[i].ready.store(false);
+    }
+
+    wake_fd = eventfd(0, EFD_CLOEXEC);
+    if (wake_fd < 0) {
+        perror("批量写盘 eventfd 创建失败");
+        frame_batch_close();
+        return -1;
+    }
+
+    if (cfg->event_trigger) {
+        preroll_data = (uint8_t *)malloc(frame_size * BATCH_PREROLL_FRAMES);
+        if (preroll_data == NULL) {
+            perror("事件预留缓冲分配失败");
+            frame_batch_close();
+            return -1;
+        }
+    }
+
+    if (cfg->compress) {
+#ifdef HAVE_ZLIB
+        compress_buffer_size = sizeof(BatchFileHeader) + compressBound(buffer_size);
+        compress_buffer = (uint8_t *)malloc(compress_buffer_size);
+        if (compress_buffer == NULL) {
+            perror("压缩缓冲分配失败");
+            frame_batch_close();
+            return -1;
+        }
+#else
+        fprintf(stderr, "警告：未使用 zlib 构建（HAVE_ZLIB），批文件不压缩\n");
+        config.compress = false;
+#endif
+    }
+
+    filling = 0;
+    next_sequence = 0;
+    preroll_head = 0;
+    preroll_count = 0;
+    in_event = false;
+    postroll_remaining = 0;
+    batches_written.store(0);
+    batches_dropped.store(0);
+
+    writer_running.store(true, std::memory_order_release);
+    if (pthread_create(&writer_thread, NULL, writer_loop, NULL) != 0) {
+        perror("批量写盘线程创建失败");
+        writer_running.store(false);
+        frame_batch_close();
+        return -1;
+    }
+    thread_started = true;
+
+    printf("批量采集已启用: %s, 每批 %d 帧（%zu KB）, 抽帧间隔 %d, 事件触发 %s, 压缩 %s\n",
+           batch_dir, config.batch_frames, buffer_size / 1024, config.sample_every,
+           config.event_trigger ? "开" : "关", config.compress ? "zlib" : "关");
+    return 0;
+}
+
+void frame_batch_get_stats(uint64_t *written, uint64_t *dropped) {
+    if (written != NULL) *written = batches_written.load();
+    if (dropped != NULL) *dropped = batches_dropped.load();
+}
+
+void frame_batch_close() {
+    if (thread_started) {
+        // 最后一批未满也写出（由采集线程在主循环结束后调用）
+        if (buffers[filling].count > 0 && !buffers[filling].ready.load(std::memory_order_acquire)) {
+            buffers[filling].sequence = next_sequence++;
+            buffers[filling].ready.store(true, std::memory_order_release);
+        }
+        writer_running.store(false, std::memory_order_release);
+        wake_writer();
+
+        pthread_join(writer_thread, NULL);
+        thread_started = false;
+
+        printf("批量采集已关闭: 写入 %llu 批, 丢弃 %llu 批\n",
+               (unsigned long long)batches_written.load(),
+               (unsigned long long)batches_dropped.load());
+    }
+
+    for (int i = 0; i < BATCH_BUFFERS; i++) {
+        free(buffers[i].data);
+        buffers[i].data = NULL;
+        buffers[i].count = 0;
+        buffers[i].ready.store(false);
+    }
+    if (wake_fd >= 0) {
+        close(wake_fd);
+        wake_fd = -1;
+    }
+    free(preroll_data);
+    preroll_data = NULL;
+#ifdef HAVE_ZLIB
+    free(compress_buffer);
+    compress_buffer = NULL;
+#endif
+}
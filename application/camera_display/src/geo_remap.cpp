@@ -0,0 +1,382 @@
+#include "geo_remap.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "simd_vec.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// 分块大小：16x8 输出像素为一块，表项按块顺序连续存放
+#define GEO_TILE_W      16
+#define GEO_TILE_H      8
+
+// 插值权重精度 Q7（0-128）
+#define GEO_FRAC_BITS   7
+#define GEO_FRAC_ONE    (1 << GEO_FRAC_BITS)
+
+// 重映射表：按块顺序存放的结构数组，权重与掩码可整段向量读取；
+// 超出源图像的像素偏移置0、掩码置0，取像素时无需分支
+struct GeoMap {
+    int32_t *offset;                // 双线性左上角源像素偏移
+    int32_t *nearest;               // 最近邻源像素偏移（初始化时已取整）
+    uint8_t *fx;                    // 水平小数部分（Q7）
+    uint8_t *fy;                    // 垂直小数部分（Q7）
+    uint8_t *mask;                  // 0xff:有效 0:超出源图像（输出黑色）
+};
+
+// 标定参数
+struct GeoCalib {
+    double fx, fy, cx, cy;
+    double k1, k2, k3, p1, p2;
+    double H[9];
+};
+
+// 内部状态
+static GeoMap map_table = { NULL, NULL, NULL, NULL, NULL };
+static uint16_t map_width = 0;
+static uint16_t map_height = 0;
+
+/**
+ * @brief 读取标定文件
+ */
+static int load_calib(const char *path, GeoCalib *calib, uint16_t width, uint16_t height) {
+    memset(calib, 0, sizeof(*calib));
+    calib->cx = width / 2.0;
+    calib->cy = height / 2.0;
+    calib->H[0] = calib->H[4] = calib->H[8] = 1.0;
+
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        perror("打开标定文件失败");
+        return -1;
+    }
+
+    char line[512];
+    int line_no = 0;
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        line_no++;
+        char *p = line;
+        while (*p == ' ' || *p == '\t') p++;
+        if (*p == '#' || *p == '\n' || *p == '\r' || *p == '\0') {
+            continue;
+        }
+
+        char key[16];
+        int consumed = 0;
+        if (sscanf(p, "%15[^= \t] = %n", key, &consumed) != 1 || consumed == 0) {
+            fprintf(stderr, "标定文件第%d行格式错误\n", line_no);
+            fclose(fp);
+            return -1;
+        }
+        const char *value = p + consumed;
+
+        double *target = NULL;
+        if (strcmp(key, "fx") == 0) target = &calib->fx;
+        else if (strcmp(key, "fy") == 0) target = &calib->fy;
+        else if (strcmp(key, "cx") == 0) target = &calib->cx;
+        else if (strcmp(key, "cy") == 0) target = &calib->cy;
+        else if (strcmp(key, "k1") == 0) target = &calib->k1;
+        else if (strcmp(key, "k2") == 0) target = &calib->k2;
+        else if (strcmp(key, "k3") == 0) target = &calib->k3;
+        else if (strcmp(key, "p1") == 0) target = &calib->p1;
+        else if (strcmp(key, "p2") == 0) target = &calib->p2;
+
+        if (target != NULL) {
+            *target = atof(value);
+        } else if (strcmp(key, "H") == 0) {
+            double *h = calib->H;
+            if (sscanf(value, "%lf %lf %lf %lf %lf %lf %lf %lf %lf",
+                       &h[0], &h[1], &h[2], &h[3], &h[4], &h[5], &h[6], &h[7], &h[8]) != 9) {
+                fprintf(stderr, "标定文件第%d行：H 需要9个数\n", line_no);
+                fclose(fp);
+                return -1;
+            }
+        } else {
+            fprintf(stderr, "标定文件第%d行：未知参数 %s（已忽略）\n", line_no, key);
+        }
+    }
+
+    fclose(fp);
+    return 0;
+}
+
+/**
+ * @brief 计算输出像素 (u, v) 对应的源图像坐标
+ */
+static void map_point(const GeoCalib *c, double u, double v, double *sx, double *sy) {
+    // 1. 透视变换：输出像素 -> 去畸变图像像素
+    double w = c->H[6] * u + c->H[7] * v + c->H[8];
+    if (fabs(w) < 1e-12) {
+        *sx = *sy = -1e9;
+        return;
+    }
+    double xu = (c->H[0] * u + c->H[1] * v + c->H[2]) / w;
+    double yu = (c->H[3] * u + c->H[4] * v + c->H[5]) / w;
+
+    if (c->fx == 0 || c->fy == 0) {
+        *sx = xu;
+        *sy = yu;
+        return;
+    }
+
+    // 2. 畸变模型：去畸变像素 -> 原始（有畸变）像素
+    double x = (xu - c->cx) / c->fx;
+    double y = (yu - c->cy) / c->fy;
+    double r2 = x * x + y * y;
+    double radial = 1 + c->k1 * r2 + c->k2 * r2 * r2 + c->k3 * r2 * r2 * r2;
+    double xd = x * radial + 2 * c->p1 * x * y + c->p2 * (r2 + 2 * x * x);
+    double yd = y * radial + c->p1 * (r2 + 2 * y * y) + 2 * c->p2 * x * y;
+    *sx = xd * c->fx + c->cx;
+    *sy = yd * c->fy + c->cy;
+}
+
+static void build_entry(size_t idx, double sx, double sy) {
+    GeoMap *m = &map_table;
+    if (!(sx >= 0 && sy >= 0 && sx <= map_width - 1 && sy <= map_height - 1)) {
+        m->offset[idx] = m->nearest[idx] = 0;
+        m->fx[idx] = m->fy[idx] = 0;
+        m->mask[idx] = 0;
+        return;
+    }
+
+    // 保证右下邻点在图像内：最后一列/行使用 x0=w-2, fx=1
+    int x0 = (int)sx;
+    int y0 = (int)sy;
+    if (x0 > map_width - 2) x0 = map_width - 2;
+    if (y0 > map_height - 2) y0 = map_height - 2;
+
+    m->offset[idx] = y0 * map_width + x0;
+    m->fx[idx] = (uint8_t)lround((sx - x0) * GEO_FRAC_ONE);
+    m->fy[idx] = (uint8_t)lround((sy - y0) * GEO_FRAC_ONE);
+    m->mask[idx] = 0xff;
+
+    // 最近邻：小数部分过半取右/下邻点
+    m->nearest[idx] = m->offset[idx];
+    if (m->fx[idx] >= (GEO_FRAC_ONE >> 1)) m->nearest[idx] += 1;
+    if (m->fy[idx] >= (GEO_FRAC_ONE >> 1)) m->nearest[idx] += map_width;
+}
+
+int geo_remap_init(const char *calib_path, uint16_t width, uint16_t height) {
+    if (width < 2 || height < 2) {
+        return -1;
+    }
+
+    GeoCalib calib;
+    if (load_calib(calib_path, &calib, width, height) < 0) {
+        return -1;
+    }
+
+    geo_remap_close();
+    // 各数组放在同一块内存中，偏移数组在前保证4字节对齐
+    size_t pixels = (size_t)width * height;
+    uint8_t *block = (uint8_t *)malloc(pixels * (2 * sizeof(int32_t) + 3));
+    if (block == NULL) {
+        perror("重映射表分配失败");
+        return -1;
+    }
+    map_table.offset = (int32_t *)block;
+    map_table.nearest = map_table.offset + pixels;
+    map_table.fx = (uint8_t *)(map_table.nearest + pixels);
+    map_table.fy = map_table.fx + pixels;
+    map_table.mask = map_table.fy + pixels;
+    map_width = width;
+    map_height = height;
+
+    // 按块顺序生成表项，与 geo_remap_apply 的遍历顺序一致
+    size_t idx = 0;
+    int valid = 0;
+    for (int ty = 0; ty < height; ty += GEO_TILE_H) {
+        int th = (height - ty < GEO_TILE_H) ? height - ty : GEO_TILE_H;
+        for (int tx = 0; tx < width; tx += GEO_TILE_W) {
+            int tw = (width - tx < GEO_TILE_W) ? width - tx : GEO_TILE_W;
+            for (int y = ty; y < ty + th; y++) {
+                for (int x = tx; x < tx + tw; x++) {
+                    double sx, sy;
+                    map_point(&calib, x, y, &sx, &sy);
+                    build_entry(idx, sx, sy);
+                    if (map_table.mask[idx]) valid++;
+                    idx++;
+                }
+            }
+        }
+    }
+
+    // 估算单帧耗时
+    uint8_t *src = (uint8_t *)calloc(pixels, 2);
+    if (src != NULL) {
+        struct timespec t0, t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        for (int i = 0; i < 100; i++) {
+            geo_remap_apply(src, src + pixels, GEO_INTERP_BILINEAR);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        double us = ((t1.tv_sec - t0.tv_sec) * 1e6 + (t1.tv_nsec - t0.tv_nsec) / 1e3) / 100;
+        free(src);
+        printf("几何校正已启用: %s, 有效像素 %d%%, 双线性单帧耗时 %.1f us\n",
+               calib_path, valid * 100 / (width * height), us);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief 双线性插值（标量），与向量版本使用相同的定点运算
+ */
+static inline uint8_t bilinear_pixel(const GeoMap *m, const uint8_t *src, size_t idx, int stride) {
+    const uint8_t *p = src + m->offset[idx];
+    int fx = m->fx[idx];
+    int fy = m->fy[idx];
+    int top = p[0] * (GEO_FRAC_ONE - fx) + p[1] * fx;
+    int bot = p[stride] * (GEO_FRAC_ONE - fx) + p[stride + 1] * fx;
+    top = (top + (GEO_FRAC_ONE >> 1)) >> GEO_FRAC_BITS;
+    bot = (bot + (GEO_FRAC_ONE >> 1)) >> GEO_FRAC_BITS;
+    int res = (top * (GEO_FRAC_ONE - fy) + bot * fy + (GEO_FRAC_ONE >> 1)) >> GEO_FRAC_BITS;
+    return (uint8_t)(res & m->mask[idx]);
+}
+
+/**
+ * @brief 最近邻取值：取整与越界判断已在初始化时完成，逐像素只剩一次读取，
+ *        无可向量化的运算（按16像素组装向量再合成掩码实测反而更慢）
+ */
+static inline uint8_t nearest_pixel(const GeoMap *m, const uint8_t *src, size_t idx) {
+    return src[m->nearest[idx]] & m->mask[idx];
+}
+
+#if defined(__SSE2__)
+/**
+ * @brief 8个像素的双线性插值（16位定点），结果每通道不超过255
+ */
+static inline __m128i bilinear_x8(const GeoMap *m, const uint8_t *src, size_t idx, int stride) {
+    // 邻点逐个读取（SSE2 无 gather）
+    uint16_t a[8], b[8], c[8], d[8];
+    for (int k = 0; k < 8; k++) {
+        const uint8_t *p = src + m->offset[idx + k];
+        a[k] = p[0];
+        b[k] = p[1];
+        c[k] = p[stride];
+        d[k] = p[stride + 1];
+    }
+    __m128i va = _mm_loadu_si128((const __m128i *)a);
+    __m128i vb = _mm_loadu_si128((const __m128i *)b);
+    __m128i vc = _mm_loadu_si128((const __m128i *)c);
+    __m128i vd = _mm_loadu_si128((const __m128i *)d);
+
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi16(GEO_FRAC_ONE);
+    const __m128i half = _mm_set1_epi16(GEO_FRAC_ONE >> 1);
+    __m128i vfx = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(m->fx + idx)), zero);
+    __m128i vfy = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(m->fy + idx)), zero);
+    __m128i ifx = _mm_sub_epi16(one, vfx);
+    __m128i ify = _mm_sub_epi16(one, vfy);
+
+    // 最大值 255*128 = 32640，16位内不会溢出
+    __m128i top = _mm_add_epi16(_mm_mullo_epi16(va, ifx), _mm_mullo_epi16(vb, vfx));
+    __m128i bot = _mm_add_epi16(_mm_mullo_epi16(vc, ifx), _mm_mullo_epi16(vd, vfx));
+    top = _mm_srli_epi16(_mm_add_epi16(top, half), GEO_FRAC_BITS);
+    bot = _mm_srli_epi16(_mm_add_epi16(bot, half), GEO_FRAC_BITS);
+    __m128i res = _mm_add_epi16(_mm_mullo_epi16(top, ify), _mm_mullo_epi16(bot, vfy));
+    return _mm_srli_epi16(_mm_add_epi16(res, half), GEO_FRAC_BITS);
+}
+
+/**
+ * @brief 16个像素的双线性插值，掩码整段合成
+ */
+static inline void bilinear_x16(const GeoMap *m, const uint8_t *src, size_t idx, int stride,
+                                uint8_t *out) {
+    __m128i v = _mm_packus_epi16(bilinear_x8(m, src, idx, stride),
+                                 bilinear_x8(m, src, idx + 8, stride));
+    v = _mm_and_si128(v, _mm_loadu_si128((const __m128i *)(m->mask + idx)));
+    _mm_storeu_si128((__m128i *)out, v);
+}
+#elif defined(SIMD_VEC_AVAILABLE)
+/**
+ * @brief 8个像素的双线性插值（16位定点），结果每通道不超过255
+ */
+static inline vec_u16x8 bilinear_x8(const GeoMap *m, const uint8_t *src, size_t idx, int stride) {
+    // 邻点逐个读取（LSX 无 gather），直接组装为向量避免经内存中转
+    const int32_t *o = m->offset + idx;
+    const uint8_t *p0 = src + o[0], *p1 = src + o[1], *p2 = src + o[2], *p3 = src + o[3];
+    const uint8_t *p4 = src + o[4], *p5 = src + o[5], *p6 = src + o[6], *p7 = src + o[7];
+    vec_u16x8 va = { p0[0], p1[0], p2[0], p3[0], p4[0], p5[0], p6[0], p7[0] };
+    vec_u16x8 vb = { p0[1], p1[1], p2[1], p3[1], p4[1], p5[1], p6[1], p7[1] };
+    p0 += stride; p1 += stride; p2 += stride; p3 += stride;
+    p4 += stride; p5 += stride; p6 += stride; p7 += stride;
+    vec_u16x8 vc = { p0[0], p1[0], p2[0], p3[0], p4[0], p5[0], p6[0], p7[0] };
+    vec_u16x8 vd = { p0[1], p1[1], p2[1], p3[1], p4[1], p5[1], p6[1], p7[1] };
+
+    const vec_u16x8 one = vec_u16x8() + GEO_FRAC_ONE;
+    const vec_u16x8 half = vec_u16x8() + (GEO_FRAC_ONE >> 1);
+    vec_u16x8 vfx = vec_load_u8x8(m->fx + idx);
+    vec_u16x8 vfy = vec_load_u8x8(m->fy + idx);
+    vec_u16x8 ifx = one - vfx;
+    vec_u16x8 ify = one - vfy;
+
+    // 最大值 255*128 = 32640，16位内不会溢出
+    vec_u16x8 top = (va * ifx + vb * vfx + half) >> GEO_FRAC_BITS;
+    vec_u16x8 bot = (vc * ifx + vd * vfx + half) >> GEO_FRAC_BITS;
+    return (top * ify + bot * vfy + half) >> GEO_FRAC_BITS;
+}
+
+/**
+ * @brief 16个像素的双线性插值，掩码整段合成
+ */
+static inline void bilinear_x16(const GeoMap *m, const uint8_t *src, size_t idx, int stride,
+                                uint8_t *out) {
+    vec_u8x16 v = vec_narrow_u16(bilinear_x8(m, src, idx, stride),
+                                 bilinear_x8(m, src, idx + 8, stride));
+    v &= vec_load_u8(m->mask + idx);
+    memcpy(out, &v, sizeof(v));
+}
+#endif
+
+int geo_remap_apply(const uint8_t *src, uint8_t *dst, enum GeoInterp interp) {
+    if (map_table.offset == NULL || src == NULL || dst == NULL) {
+        return -1;
+    }
+
+    // 表指针取局部副本：输出为 uint8_t*，写出会使编译器认为全局表指针可能被改写而反复重读
+    const GeoMap table = map_table;
+    const GeoMap *m = &table;
+    size_t idx = 0;
+    const int stride = map_width;
+
+    for (int ty = 0; ty < map_height; ty += GEO_TILE_H) {
+        int th = (map_height - ty < GEO_TILE_H) ? map_height - ty : GEO_TILE_H;
+        for (int tx = 0; tx < map_width; tx += GEO_TILE_W) {
+            int tw = (map_width - tx < GEO_TILE_W) ? map_width - tx : GEO_TILE_W;
+            for (int y = ty; y < ty + th; y++) {
+                uint8_t *out = dst + y * stride + tx;
+                int x = 0;
+                if (interp == GEO_INTERP_BILINEAR) {
+#if defined(__SSE2__) || defined(SIMD_VEC_AVAILABLE)
+                    for (; x + 16 <= tw; x += 16) {
+                        bilinear_x16(m, src, idx + x, stride, out + x);
+                    }
+#endif
+                    for (; x < tw; x++) {
+                        out[x] = bilinear_pixel(m, src, idx + x, stride);
+                    }
+                } else {
+                    for (; x < tw; x++) {
+                        out[x] = nearest_pixel(m, src, idx + x);
+                    }
+                }
+                idx += tw;
+            }
+        }
+    }
+
+    return 0;
+}
+
+void geo_remap_close() {
+    // 各数组共用 offset 起始的同一块内存
+    free(map_table.offset);
+    memset(&map_table, 0, sizeof(map_table));
+    map_width = 0;
+    map_height = 0;
+}
@@ -0,0 +1,922 @@
+#include "http_stream.h"
+#include "rt_profile.h"
+#include <opencv2/opencv.hpp>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/uio.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <atomic>
+#include <vector>
+
+#define HTTP_FRAME_POOL     4           // 帧缓冲池（慢客户端可继续持有旧帧）
+#define HTTP_REQ_MAX        2048        // 请求头最大长度
+#define HTTP_HEAD_MAX       2048        // 响应头/小型响应体最大长度
+#define HTTP_MAX_EVENTS     64
+#define HTTP_GRAY_RESERVE   (320 * 240)
+#define HTTP_JPEG_RESERVE   (64 * 1024)
+
+#define PENDING_SLOTS       3           // 交接三缓冲
+#define PENDING_INDEX       0x3
+#define PENDING_NEW         0x4         // 中间槽中有网络线程尚未取走的新帧
+
+#define EPOLL_TAG_LISTEN    0xFFFFFFFFu
+#define EPOLL_TAG_WAKE      0xFFFFFFFEu
+
+static_assert(sizeof(WsFrameHeader) == 32, "WsFrameHeader 版本2必须为32字节");
+
+// 共享帧（网络线程内使用引用计数，不需要原子操作）
+struct HttpFrame {
+    std::vector<uint8_t> gray;
+    std::vector<uint8_t> jpeg;
+    uint16_t width;
+    uint16_t height;
+    uint32_t sequence;
+    uint32_t timestamp;
+    bool has_jpeg;
+    bool has_luma;
+    LumaStats luma;
+    int refs;
+};
+
+enum ClientState {
+    CLIENT_FREE = 0,
+    CLIENT_REQUEST,                 // 正在读取请求头
+    CLIENT_RESPONSE,                // 一次性响应，发送完毕后关闭
+    CLIENT_MJPEG,                   // MJPEG流
+    CLIENT_WS                       // WebSocket流
+};
+
+struct HttpClient {
+    int fd;
+    ClientState state;
+    bool ws_jpeg;                   // WebSocket输出格式（true: JPEG）
+    bool busy;                      // 是否有未发送完的数据
+    bool want_out;                  // 是否已注册EPOLLOUT
+    char req[HTTP_REQ_MAX];
+    size_t req_len;
+    char head[HTTP_HEAD_MAX];
+    size_t head_len;
+    HttpFrame *frame;               // 正在发送的帧
+    const uint8_t *body;
+    size_t body_len;
+    const char *tail;
+    size_t tail_len;
+    size_t sent;                    // head+body+tail 已发送字节数
+    uint32_t last_sequence;
+};
+
+// 内部状态
+static int listen_fd = -1;
+static int epoll_fd = -1;
+static int wake_fd = -1;
+static pthread_t server_thread;
+static bool thread_started = false;
+static std::atomic<bool> server_running(false);
+static std::atomic<int> stream_clients(0);
+static std::atomic<bool> ws_default_jpeg(false);
+
+static HttpClient clients[HTTP_MAX_CLIENTS];
+static HttpFrame frame_pool[HTTP_FRAME_POOL];
+static HttpFrame *latest_frame = NULL;
+
+// 采集线程 -> 网络线程 交接（三缓冲，无锁）：
+// 采集线程独占 pending_back 写入，写完与中间槽交换并置 PENDING_NEW；
+// 网络线程发现 PENDING_NEW 时用 pending_front 换出中间槽。采集线程不等待网络线程，只保留最新一帧
+static HttpFrame pending_frames[PENDING_SLOTS];
+static int pending_back = 0;                    // 仅采集线程访问
+static std::atomic<int> pending_middle(1);      // 槽序号 | PENDING_NEW
+static int pending_front = 2;                   // 仅网络线程访问
+static uint32_t publish_sequence = 0;
+
+// 统计（仅网络线程写入）
+static uint64_t stat_frames = 0;
+static uint64_t stat_dropped = 0;
+static uint64_t stat_bytes = 0;
+static uint32_t stat_fps_window_start = 0;
+static uint32_t stat_fps_window_frames = 0;
+static double stat_fps = 0;
+static int stat_mjpeg_clients = 0;
+static int stat_ws_clients = 0;
+static bool stat_passthrough = false;
+
+static const char *mjpeg_tail = "\r\n";
+
+static const char *index_html =
+    "<!DOCTYPE html><html><head><meta charset=\"utf-8\"><title>LS2K0300 Camera</title>"
+    "<style>body{background:#222;color:#ddd;font-family:sans-serif;text-align:center}"
+    "img{image-rendering:pixelated;width:640px;height:480px;background:#000}</style></head>"
+    "<body><h3>LS2K0300 USB摄像头</h3><img src=\"/stream.mjpg\"><pre id=\"s\"></pre>"
+    "<script>setInterval(function(){fetch('/stats').then(function(r){return r.text()})"
+    ".then(function(t){document.getElementById('s').textContent=t})},1000)</script>"
+    "</body></html>";
+
+/**
+ * @brief 获取当前时间戳（毫秒）
+ */
+static uint32_t get_timestamp_ms() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (uint32_t)(tv.tv_sec * 1000 + tv.tv_usec / 1000);
+}
+
+/**
+ * @brief 设置socket为非阻塞模式
+ */
+static int set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags == -1) return -1;
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+// ==================== WebSocket 握手（SHA1 + Base64） ====================
+
+static uint32_t rol32(uint32_t v, int n) {
+    return (v << n) | (v >> (32 - n));
+}
+
+static void sha1(const uint8_t *data, size_t len, uint8_t out[20]) {
+    uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+    uint8_t block[64];
+    uint64_t bit_len = (uint64_t)len * 8;
+    size_t total = ((len + 8) / 64 + 1) * 64;
+
+    for (size_t offset = 0; offset < total; offset += 64) {
+        // 构造当前块（原始数据 + 0x80 填充 + 长度）
+        for (int i = 0; i < 64; i++) {
+            size_t pos = offset + i;
+            if (pos < len) block[i] = data[pos];
+            else if (pos == len) block[i] = 0x80;
+            else if (pos >= total - 8) block[i] = (uint8_t)(bit_len >> ((total - 1 - pos) * 8));
+            else block[i] = 0;
+        }
+
+        uint32_t w[80];
+        for (int i = 0; i < 16; i++) {
+            w[i] = ((uint32_t)block[i * 4] << 24) | ((uint32_t)block[i * 4 + 1] << 16) |
+                   ((uint32_t)block[i * 4 + 2] << 8) | block[i * 4 + 3];
+        }
+        for (int i = 16; i < 80; i++) {
+            w[i] = rol32(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; i++) {
+            uint32_t f, k;
+            if (i < 20)      { f = (b & c) | (~b & d);          k = 0x5A827999; }
+            else if (i < 40) { f = b ^ c ^ d;                   k = 0x6ED9EBA1; }
+            else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+            else             { f = b ^ c ^ d;                   k = 0xCA62C1D6; }
+            uint32_t temp = rol32(a, 5) + f + e + k + w[i];
+            e = d; d = c; c = rol32(b, 30); b = a; a = temp;
+        }
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+    }
+
+    for (int i = 0; i < 5; i++) {
+        out[i * 4]     = (uint8_t)(h[i] >> 24);
+        out[i * 4 + 1] = (uint8_t)(h[i] >> 16);
+        out[i * 4 + 2] = (uint8_t)(h[i] >> 8);
+        out[i * 4 + 3] = (uint8_t)h[i];
+    }
+}
+
+static void base64_encode(const uint8_t *data, size_t len, char *out) {
+    static const char table[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    size_t j = 0;
+    for (size_t i = 0; i < len; i += 3) {
+        uint32_t v = (uint32_t)data[i] << 16;
+        if (i + 1 < len) v |= (uint32_t)data[i + 1] << 8;
+        if (i + 2 < len) v |= data[i + 2];
+        out[j++] = table[(v >> 18) & 0x3F];
+        out[j++] = table[(v >> 12) & 0x3F];
+        out[j++] = (i + 1 < len) ? table[(v >> 6) & 0x3F] : '=';
+        out[j++] = (i + 2 < len) ? table[v & 0x3F] : '=';
+    }
+    out[j] = '\0';
+}
+
+// ==================== 客户端管理 ====================
+
+static void update_epoll(HttpClient *client, int index, bool want_out) {
+    if (client->want_out == want_out) {
+        return;
+    }
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | (want_out ? (uint32_t)EPOLLOUT : 0u);
+    ev.data.u32 = (uint32_t)index;
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, client->fd, &ev);
+    client->want_out = want_out;
+}
+
+static void release_frame(HttpClient *client) {
+    if (client->frame != NULL) {
+        client->frame->refs--;
+        client->frame = NULL;
+    }
+}
+
+static void close_client(int index) {
+    HttpClient *client = &clients[index];
+    if (client->state == CLIENT_FREE) {
+        return;
+    }
+
+    if (client->state == CLIENT_MJPEG) stat_mjpeg_clients--;
+    if (client->state == CLIENT_WS) stat_ws_clients--;
+    stream_clients.store(stat_mjpeg_clients + stat_ws_clients);
+
+    release_frame(client);
+    client->busy = false;
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, client->fd, NULL);
+    close(client->fd);
+    client->fd = -1;
+    client->state = CLIENT_FREE;
+}
+
+static void queue_frame(HttpClient *client, int index, HttpFrame *frame);
+
+/**
+ * @brief 发送客户端待发数据（head + body + tail），遇到EAGAIN时注册EPOLLOUT
+ */
+static void flush_client(int index) {
+    HttpClient *client = &clients[index];
+
+    while (client->busy) {
+        size_t total = client->head_len + client->body_len + client->tail_len;
+        size_t off = client->sent;
+        struct iovec iov[3];
+        int iovcnt = 0;
+
+        if (off < client->head_len) {
+            iov[iovcnt].iov_base = client->head + off;
+            iov[iovcnt].iov_len = client->head_len - off;
+            iovcnt++;
+            off = 0;
+        } else {
+            off -= client->head_len;
+        }
+        if (client->body_len > 0 && off < client->body_len) {
+            iov[iovcnt].iov_base = (void *)(client->body + off);
+            iov[iovcnt].iov_len = client->body_len - off;
+            iovcnt++;
+            off = 0;
+        } else {
+            off -= client->body_len;
+        }
+        if (client->tail_len > 0 && off < client->tail_len) {
+            iov[iovcnt].iov_base = (void *)(client->tail + off);
+            iov[iovcnt].iov_len = client->tail_len - off;
+            iovcnt++;
+        }
+
+        ssize_t n = writev(client->fd, iov, iovcnt);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                update_epoll(client, index, true);
+                return;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            close_client(index);
+            return;
+        }
+
+        stat_bytes += n;
+        client->sent += n;
+        if (client->sent < total) {
+            continue;
+        }
+
+        // 当前消息发送完毕
+        client->busy = false;
+        release_frame(client);
+        update_epoll(client, index, false);
+
+        if (client->state == CLIENT_RESPONSE) {
+            close_client(index);
+            return;
+        }
+
+        // 发送期间有更新的帧到达：直接跳到最新帧
+        if ((client->state == CLIENT_MJPEG || client->state == CLIENT_WS) &&
+            latest_frame != NULL && latest_frame->sequence != client->last_sequence) {
+            queue_frame(client, index, latest_frame);
+        }
+        return;
+    }
+}
+
+static void set_response(HttpClient *client, const char *head, size_t head_len,
+                         const uint8_t *body, size_t body_len) {
+    if (head_len > HTTP_HEAD_MAX) head_len = HTTP_HEAD_MAX;
+    memcpy(client->head, head, head_len);
+    client->head_len = head_len;
+    client->body = body;
+    client->body_len = body_len;
+    client->tail = NULL;
+    client->tail_len = 0;
+    client->sent = 0;
+    client->busy = true;
+}
+
+/**
+ * @brief 为流客户端准备一帧（MJPEG分段或WebSocket二进制消息）
+ */
+static void queue_frame(HttpClient *client, int index, HttpFrame *frame) {
+    if (client->busy || frame == NULL) {
+        return;
+    }
+
+    bool want_jpeg = (client->state == CLIENT_MJPEG) || client->ws_jpeg;
+    if (want_jpeg && !frame->has_jpeg) {
+        return;  // 编码失败，跳过该帧
+    }
+
+    const uint8_t *data = want_jpeg ? frame->jpeg.data() : frame->gray.data();
+    size_t data_len = want_jpeg ? frame->jpeg.size() : frame->gray.size();
+    int head_len = 0;
+
+    if (client->state == CLIENT_MJPEG) {
+        head_len = snprintf(client->head, HTTP_HEAD_MAX,
+                            "--frame\r\nContent-Type: image/jpeg\r\n"
+                            "Content-Length: %u\r\nX-Timestamp: %u\r\n",
+                            (unsigned)data_len, frame->timestamp);
+        if (frame->has_luma) {
+            head_len += snprintf(client->head + head_len, HTTP_HEAD_MAX - head_len,
+                                 "X-Luma-Mean: %u\r\nX-Luma-Percentiles: %u,%u,%u\r\n",
+                                 frame->luma.mean, frame->luma.p5,
+                                 frame->luma.p50, frame->luma.p95);
+        }
+        head_len += snprintf(client->head + head_len, HTTP_HEAD_MAX - head_len, "\r\n");
+        client->tail = mjpeg_tail;
+        client->tail_len = 2;
+    } else {
+        struct WsFrameHeader meta;
+        meta.magic = 0x12345678;
+        meta.header_size = sizeof(meta);
+        meta.version = WS_FRAME_VERSION;
+        meta.width = frame->width;
+        meta.height = frame->height;
+        meta.format = want_jpeg ? 1 : 0;
+        meta.sequence = frame->sequence;
+        meta.timestamp = frame->timestamp;
+        meta.data_size = (uint32_t)data_len;
+        meta.luma_mean = frame->has_luma ? frame->luma.mean : 0;
+        meta.luma_p5 = frame->has_luma ? frame->luma.p5 : 0;
+        meta.luma_p50 = frame->has_luma ? frame->luma.p50 : 0;
+        meta.luma_p95 = frame->has_luma ? frame->luma.p95 : 0;
+
+        // WebSocket 帧头：FIN + 二进制，服务端不加掩码
+        uint64_t payload_len = sizeof(meta) + data_len;
+        uint8_t *p = (uint8_t *)client->head;
+        p[head_len++] = 0x82;
+        if (payload_len < 126) {
+            p[head_len++] = (uint8_t)payload_len;
+        } else if (payload_len <= 0xFFFF) {
+            p[head_len++] = 126;
+            p[head_len++] = (uint8_t)(payload_len >> 8);
+            p[head_len++] = (uint8_t)payload_len;
+        } else {
+            p[head_len++] = 127;
+            for (int i = 7; i >= 0; i--) {
+                p[head_len++] = (uint8_t)(payload_len >> (i * 8));
+            }
+        }
+        memcpy(p + head_len, &meta, sizeof(meta));
+        head_len += sizeof(meta);
+        client->tail = NULL;
+        client->tail_len = 0;
+    }
+
+    client->head_len = head_len;
+    client->body = data;
+    client->body_len = data_len;
+    client->sent = 0;
+    client->busy = true;
+    client->frame = frame;
+    client->last_sequence = frame->sequence;
+    frame->refs++;
+
+    flush_client(index);
+}
+
+// ==================== 请求处理 ====================
+
+static void respond_simple(int index, const char *status, const char *type,
+                           const char *body, size_t body_len) {
+    HttpClient *client = &clients[index];
+    char head[512];
+    int n = snprintf(head, sizeof(head),
+                     "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %u\r\n"
+                     "Cache-Control: no-cache\r\nAccess-Control-Allow-Origin: *\r\n"
+                     "Connection: close\r\n\r\n",
+                     status, type, (unsigned)body_len);
+
+    // 小型响应体直接拼接到头部缓冲区，大响应体引用静态数据
+    if (n + body_len <= HTTP_HEAD_MAX) {
+        memcpy(client->head, head, n);
+        memcpy(client->head + n, body, body_len);
+        client->head_len = n + body_len;
+        client->body = NULL;
+        client->body_len = 0;
+        client->tail = NULL;
+        client->tail_len = 0;
+        client->sent = 0;
+        client->busy = true;
+    } else {
+        set_response(client, head, n, (const uint8_t *)body, body_len);
+    }
+
+    client->state = CLIENT_RESPONSE;
+    flush_client(index);
+}
+
+static void respond_stats(int index) {
+    char body[1024];
+    int n = snprintf(body, sizeof(body),
+                     "{\"frames\":%llu,\"dropped\":%llu,\"fps\":%.1f,"
+                     "\"bytes_sent\":%llu,\"clients\":{\"mjpeg\":%d,\"websocket\":%d},"
+                     "\"width\":%d,\"height\":%d,\"jpeg_passthrough\":%s",
+                     (unsigned long long)stat_frames, (unsigned long long)stat_dropped,
+                     stat_fps, (unsigned long long)stat_bytes,
+                     stat_mjpeg_clients, stat_ws_clients,
+                     latest_frame ? latest_frame->width : 0,
+                     latest_frame ? latest_frame->height : 0,
+                     stat_passthrough ? "true" : "false");
+
+    // 亮度统计与曝光状态
+    if (latest_frame != NULL && latest_frame->has_luma) {
+        const LumaStats *luma = &latest_frame->luma;
+        n += snprintf(body + n, sizeof(body) - n,
+                      ",\"luma\":{\"mean\":%u,\"p5\":%u,\"p50\":%u,\"p95\":%u,\"hist\":[",
+                      luma->mean, luma->p5, luma->p50, luma->p95);
+        for (int i = 0; i < LUMA_HIST_BINS; i++) {
+            n += snprintf(body + n, sizeof(body) - n, i ? ",%u" : "%u", luma->hist[i]);
+        }
+        n += snprintf(body + n, sizeof(body) - n, "]}");
+    }
+    int exposure, gain;
+    bool ae_active = auto_exposure_get_state(&exposure, &gain);
+    n += snprintf(body + n, sizeof(body) - n,
+                  ",\"auto_exposure\":{\"active\":%s,\"exposure\":%d,\"gain\":%d}}\n",
+                  ae_active ? "true" : "false", exposure, gain);
+    respond_simple(index, "200 OK", "application/json", body, n);
+}
+
+static void handle_request(int index) {
+    HttpClient *client = &clients[index];
+    char method[8];
+    char path[256];
+
+    client->req[client->req_len] = '\0';
+    if (sscanf(client->req, "%7s %255s", method, path) != 2 || strcmp(method, "GET") != 0) {
+        const char *msg = "method not allowed\n";
+        respond_simple(index, "405 Method Not Allowed", "text/plain", msg, strlen(msg));
+        return;
+    }
+
+    char *query = strchr(path, '?');
+    if (query != NULL) {
+        *query++ = '\0';
+    }
+
+    if (strcmp(path, "/") == 0 || strcmp(path, "/index.html") == 0) {
+        respond_simple(index, "200 OK", "text/html; charset=utf-8", index_html, strlen(index_html));
+    } else if (strcmp(path, "/stats") == 0) {
+        respond_stats(index);
+    } else if (strcmp(path, "/stream.mjpg") == 0) {
+        const char *head =
+            "HTTP/1.1 200 OK\r\n"
+            "Content-Type: multipart/x-mixed-replace; boundary=frame\r\n"
+            "Cache-Control: no-cache\r\nAccess-Control-Allow-Origin: *\r\n"
+            "Connection: close\r\n\r\n";
+        set_response(client, head, strlen(head), NULL, 0);
+        client->state = CLIENT_MJPEG;
+        client->last_sequence = 0;
+        stat_mjpeg_clients++;
+        stream_clients.store(stat_mjpeg_clients + stat_ws_clients);
+        flush_client(index);
+    } else if (strcmp(path, "/ws") == 0) {
+        const char *key = strcasestr(client->req, "Sec-WebSocket-Key:");
+        if (key == NULL || strcasestr(client->req, "websocket") == NULL) {
+            const char *msg = "websocket upgrade required\n";
+            respond_simple(index, "400 Bad Request", "text/plain", msg, strlen(msg));
+            return;
+        }
+
+        key += strlen("Sec-WebSocket-Key:");
+        while (*key == ' ') key++;
+        char buf[128];
+        size_t key_len = strcspn(key, "\r\n ");
+        if (key_len > 60) key_len = 60;
+        memcpy(buf, key, key_len);
+        strcpy(buf + key_len, "258EAFA5-E914-47DA-95CA-C5AB0DC85B11");
+
+        uint8_t digest[20];
+        char accept_key[32];
+        sha1((const uint8_t *)buf, strlen(buf), digest);
+        base64_encode(digest, sizeof(digest), accept_key);
+
+        char head[256];
+        int n = snprintf(head, sizeof(head),
+                         "HTTP/1.1 101 Switching Protocols\r\n"
+                         "Upgrade: websocket\r\nConnection: Upgrade\r\n"
+                         "Sec-WebSocket-Accept: %s\r\n\r\n", accept_key);
+        set_response(client, head, n, NULL, 0);
+        client->state = CLIENT_WS;
+        if (query != NULL && strstr(query, "format=jpeg") != NULL) {
+            client->ws_jpeg = true;
+        } else if (query != NULL && strstr(query, "format=gray") != NULL) {
+            client->ws_jpeg = false;
+        } else {
+            client->ws_jpeg = ws_default_jpeg.load();
+        }
+        client->last_sequence = 0;
+        stat_ws_clients++;
+        stream_clients.store(stat_mjpeg_clients + stat_ws_clients);
+        flush_client(index);
+    } else {
+        const char *msg = "not found\n";
+        respond_simple(index, "404 Not Found", "text/plain", msg, strlen(msg));
+    }
+}
+
+static void on_readable(int index) {
+    HttpClient *client = &clients[index];
+
+    if (client->state == CLIENT_REQUEST) {
+        ssize_t n = recv(client->fd, client->req + client->req_len,
+                         HTTP_REQ_MAX - 1 - client->req_len, 0);
+        if (n <= 0) {
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+            close_client(index);
+            return;
+        }
+        client->req_len += n;
+        client->req[client->req_len] = '\0';
+
+        if (strstr(client->req, "\r\n\r\n") != NULL) {
+            handle_request(index);
+        } else if (client->req_len >= HTTP_REQ_MAX - 1) {
+            close_client(index);
+        }
+        return;
+    }
+
+    // 流客户端：丢弃收到的数据，检测断开与 WebSocket 关闭帧
+    uint8_t buf[256];
+    ssize_t n = recv(client->fd, buf, sizeof(buf), 0);
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+        close_client(index);
+        return;
+    }
+    if (n > 0 && client->state == CLIENT_WS && (buf[0] & 0x0F) == 0x8) {
+        close_client(index);
+    }
+}
+
+static void accept_clients() {
+    while (true) {
+        struct sockaddr_in addr;
+        socklen_t addr_len = sizeof(addr);
+        int fd = accept(listen_fd, (struct sockaddr *)&addr, &addr_len);
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                perror("HTTP accept失败");
+            }
+            return;
+        }
+
+        int index = -1;
+        for (int i = 0; i < HTTP_MAX_CLIENTS; i++) {
+            if (clients[i].state == CLIENT_FREE) {
+                index = i;
+                break;
+            }
+        }
+        if (index < 0) {
+            close(fd);  // 连接已满
+            continue;
+        }
+
+        set_nonblocking(fd);
+        int flag = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+
+        HttpClient *client = &clients[index];
+        client->fd = fd;
+        client->state = CLIENT_REQUEST;
+        client->ws_jpeg = false;
+        client->busy = false;
+        client->want_out = false;
+        client->req_len = 0;
+        client->frame = NULL;
+        client->sent = 0;
+
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.u32 = (uint32_t)index;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            close(fd);
+            client->fd = -1;
+            client->state = CLIENT_FREE;
+        }
+    }
+}
+
+// ==================== 帧分发 ====================
+
+/**
+ * @brief 从交接槽取出最新帧放入缓冲池（交换vector，不拷贝、不分配）
+ */
+static HttpFrame *take_pending_frame() {
+    HttpFrame *slot = NULL;
+    for (int i = 0; i < HTTP_FRAME_POOL; i++) {
+        if (frame_pool[i].refs == 0 && &frame_pool[i] != latest_frame) {
+            slot = &frame_pool[i];
+            break;
+        }
+    }
+
+    if (!(pending_middle.load(std::memory_order_acquire) & PENDING_NEW)) {
+        return NULL;
+    }
+    pending_front = pending_middle.exchange(pending_front, std::memory_order_acq_rel) & PENDING_INDEX;
+    HttpFrame *pending = &pending_frames[pending_front];
+    if (slot == NULL) {
+        // 所有缓冲都被慢客户端占用：丢弃本帧
+        stat_dropped++;
+        return NULL;
+    }
+    slot->gray.swap(pending->gray);
+    slot->jpeg.swap(pending->jpeg);
+    slot->width = pending->width;
+    slot->height = pending->height;
+    slot->sequence = pending->sequence;
+    slot->timestamp = pending->timestamp;
+    slot->has_jpeg = pending->has_jpeg;
+    slot->has_luma = pending->has_luma;
+    slot->luma = pending->luma;
+
+    return slot;
+}
+
+static void dispatch_frame() {
+    HttpFrame *frame = take_pending_frame();
+    if (frame == NULL) {
+        return;
+    }
+
+    stat_passthrough = frame->has_jpeg;
+
+    // 摄像头未提供JPEG且有客户端需要时，在网络线程编码一次，所有客户端共享
+    bool need_jpeg = stat_mjpeg_clients > 0;
+    for (int i = 0; i < HTTP_MAX_CLIENTS && !need_jpeg; i++) {
+        need_jpeg = clients[i].state == CLIENT_WS && clients[i].ws_jpeg;
+    }
+    if (!frame->has_jpeg && need_jpeg) {
+        cv::Mat gray(frame->height, frame->width, CV_8UC1, frame->gray.data());
+        std::vector<int> params;
+        params.push_back(cv::IMWRITE_JPEG_QUALITY);
+        params.push_back(HTTP_JPEG_QUALITY);
+        frame->has_jpeg = cv::imencode(".jpg", gray, frame->jpeg, params);
+    }
+
+    latest_frame = frame;
+    stat_frames++;
+
+    uint32_t now = get_timestamp_ms();
+    stat_fps_window_frames++;
+    if (now - stat_fps_window_start >= 1000) {
+        stat_fps = stat_fps_window_frames * 1000.0 / (now - stat_fps_window_start);
+        stat_fps_window_start = now;
+        stat_fps_window_frames = 0;
+    }
+
+    for (int i = 0; i < HTTP_MAX_CLIENTS; i++) {
+        if ((clients[i].state == CLIENT_MJPEG || clients[i].state == CLIENT_WS) && !clients[i].busy) {
+            queue_frame(&clients[i], i, frame);
+        }
+    }
+}
+
+static void *server_loop(void *) {
+    struct epoll_event events[HTTP_MAX_EVENTS];
+
+    rt_profile_apply_thread(RT_ROLE_NETWORK);
+
+    while (server_running.load()) {
+        int n = epoll_wait(epoll_fd, events, HTTP_MAX_EVENTS, 500);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait失败");
+            break;
+        }
+
+        for (int i = 0; i < n; i++) {
+            uint32_t tag = events[i].data.u32;
+            if (tag == EPOLL_TAG_LISTEN) {
+                accept_clients();
+            } else if (tag == EPOLL_TAG_WAKE) {
+                uint64_t value;
+                if (read(wake_fd, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+                    perror("eventfd读取失败");
+                }
+                dispatch_frame();
+            } else if (tag < HTTP_MAX_CLIENTS && clients[tag].state != CLIENT_FREE) {
+                if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                    close_client(tag);
+                    continue;
+                }
+                if (events[i].events & EPOLLIN) {
+                    on_readable(tag);
+                }
+                if (clients[tag].state != CLIENT_FREE && (events[i].events & EPOLLOUT)) {
+                    flush_client(tag);
+                }
+            }
+        }
+    }
+
+    return NULL;
+}
+
+// ==================== 对外接口 ====================
+
+int http_stream_init(int port) {
+    struct sockaddr_in server_addr;
+    int opt = 1;
+
+    for (int i = 0; i < HTTP_MAX_CLIENTS; i++) {
+        clients[i].fd = -1;
+        clients[i].state = CLIENT_FREE;
+        clients[i].frame = NULL;
+    }
+
+    // 预分配帧缓冲，稳态运行时不再分配内存
+    for (int i = 0; i < HTTP_FRAME_POOL; i++) {
+        frame_pool[i].gray.reserve(HTTP_GRAY_RESERVE);
+        frame_pool[i].jpeg.reserve(HTTP_JPEG_RESERVE);
+        frame_pool[i].refs = 0;
+        frame_pool[i].has_jpeg = false;
+        frame_pool[i].has_luma = false;
+    }
+    for (int i = 0; i < PENDING_SLOTS; i++) {
+        pending_frames[i].gray.reserve(HTTP_GRAY_RESERVE);
+        pending_frames[i].jpeg.reserve(HTTP_JPEG_RESERVE);
+    }
+    pending_back = 0;
+    pending_middle.store(1);
+    pending_front = 2;
+    latest_frame = NULL;
+    stat_mjpeg_clients = 0;
+    stat_ws_clients = 0;
+    stream_clients.store(0);
+    stat_fps_window_start = get_timestamp_ms();
+
+    listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        perror("HTTP socket创建失败");
+        return -1;
+    }
+
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    set_nonblocking(listen_fd);
+
+    memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_addr.s_addr = INADDR_ANY;
+    server_addr.sin_port = htons(port);
+
+    if (bind(listen_fd, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
+        perror("HTTP bind失败");
+        http_stream_close();
+        return -1;
+    }
+
+    if (listen(listen_fd, HTTP_MAX_CLIENTS) < 0) {
+        perror("HTTP listen失败");
+        http_stream_close();
+        return -1;
+    }
+
+    epoll_fd = epoll_create1(0);
+    wake_fd = eventfd(0, EFD_NONBLOCK);
+    if (epoll_fd < 0 || wake_fd < 0) {
+        perror("epoll/eventfd创建失败");
+        http_stream_close();
+        return -1;
+    }
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u32 = EPOLL_TAG_LISTEN;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &ev);
+    ev.data.u32 = EPOLL_TAG_WAKE;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &ev);
+
+    server_running.store(true);
+    if (pthread_create(&server_thread, NULL, server_loop, NULL) != 0) {
+        perror("HTTP线程创建失败");
+        server_running.store(false);
+        http_stream_close();
+        return -1;
+    }
+    thread_started = true;
+
+    printf("HTTP服务器已启动，端口: %d (浏览器访问 http://<板卡IP>:%d/)\n", port, port);
+    return 0;
+}
+
+void http_stream_publish(const uint8_t *gray, uint16_t width, uint16_t height,
+                         const uint8_t *jpeg, uint32_t jpeg_size,
+                         const struct LumaStats *luma) {
+    // 没有流客户端时不拷贝
+    if (!server_running.load() || gray == NULL || stream_clients.load() == 0) {
+        return;
+    }
+
+    // 写入采集线程独占的槽，再与中间槽交换（网络线程未取走的旧帧被换回，下次覆盖）
+    HttpFrame *frame = &pending_frames[pending_back];
+    frame->gray.assign(gray, gray + (size_t)width * height);
+    if (jpeg != NULL && jpeg_size > 0) {
+        frame->jpeg.assign(jpeg, jpeg + jpeg_size);
+        frame->has_jpeg = true;
+    } else {
+        frame->jpeg.clear();
+        frame->has_jpeg = false;
+    }
+    frame->has_luma = (luma != NULL);
+    if (luma != NULL) {
+        frame->luma = *luma;
+    }
+    frame->width = width;
+    frame->height = height;
+    frame->sequence = ++publish_sequence;
+    frame->timestamp = get_timestamp_ms();
+    pending_back = pending_middle.exchange(pending_back | PENDING_NEW, std::memory_order_acq_rel) & PENDING_INDEX;
+
+    uint64_t one = 1;
+    if (write(wake_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+        perror("eventfd写入失败");
+    }
+}
+
+void http_stream_set_default_jpeg(bool jpeg) {
+    ws_default_jpeg.store(jpeg);
+}
+
+int http_stream_get_clients() {
+    return stream_clients.load();
+}
+
+void http_stream_close() {
+    if (thread_started) {
+        server_running.store(false);
+        uint64_t one = 1;
+        if (write(wake_fd, &one, sizeof(one)) < 0) {
+            perror("eventfd写入失败");
+        }
+        pthread_join(server_thread, NULL);
+        thread_started = false;
+    }
+
+    for (int i = 0; i < HTTP_MAX_CLIENTS; i++) {
+        if (clients[i].state != CLIENT_FREE) {
+            close(clients[i].fd);
+            clients[i].fd = -1;
+            clients[i].state = CLIENT_FREE;
+            clients[i].frame = NULL;
+        }
+    }
+
+    if (listen_fd >= 0) {
+        close(listen_fd);
+        listen_fd = -1;
+        printf("HTTP服务器已关闭\n");
+    }
+    if (wake_fd >= 0) {
+        close(wake_fd);
+        wake_fd = -1;
+    }
+    if (epoll_fd >= 0) {
+        close(epoll_fd);
+        epoll_fd = -1;
+    }
+}
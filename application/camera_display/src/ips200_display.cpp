@@ -1,4 +1,5 @@
 #include "ips200_display.h"
+#include "rt_profile.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -81,6 +82,9 @@ int ips200_display_init(const char *fb_device) {
         return -1;
     }
 
+    // 逐页访问显存映射，建立页表（mlockall 不会为 VM_IO/VM_PFNMAP 映射预先缺页）
+    rt_profile_prefault(screen_base, screen_size);
+
     // 清屏
     ips200_clear();
 
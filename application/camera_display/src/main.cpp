@@ -24,12 +24,25 @@
 *********************************************************************************************************************/
 
 #include "uvc_camera.h"
+#include "capture_supervisor.h"
 #include "ips200_display.h"
 #include "network_stream.h"
+#include "http_stream.h"
+#include "rt_profile.h"
+#include "motion_detect.h"
+#include "geo_remap.h"
+#include "control_channel.h"
+#include "auto_exposure.h"
+#include "ring_logger.h"
+#include "alloc_tracker.h"
+#include "frame_batch.h"
 #include <iostream>
+#include <stdlib.h>
 #include <signal.h>
 #include <unistd.h>
 #include <string.h>
+#include <time.h>
+#include <pthread.h>
 
 // 全局标志，用于安全退出
 static volatile bool running = true;
@@ -38,6 +51,51 @@ static volatile bool running = true;
 static bool enable_display = false;
 static bool display_initialized = false;
 
+// 实时运行配置（绑核、SCHED_FIFO、内存锁定）
+static struct RtProfileConfig rt_config;
+
+// TCP 8888 发送版本1包头（兼容旧客户端）
+static bool net_header_v2 = false;
+
+// HTTP/MJPEG/WebSocket 浏览器查看（可选）
+static bool enable_http = false;
+static int http_port = HTTP_PORT;
+static bool http_initialized = false;
+
+// 几何校正（畸变校正 + 透视变换）
+static const char *remap_calib = NULL;
+static int remap_sinks = GEO_SINK_ALL;
+static enum GeoInterp remap_interp = GEO_INTERP_BILINEAR;
+static uint8_t remap_image[UVC_WIDTH * UVC_HEIGHT];
+
+// 运行时控制通道（Unix socket）
+static const char *control_socket = CONTROL_SOCKET_PATH;
+static uint8_t roi_image[UVC_WIDTH * UVC_HEIGHT];
+
+// 变化检测：画面静止时跳过网络发送
+static bool motion_skip = false;
+static int motion_threshold = MOTION_DEFAULT_TILE_THRESHOLD;
+#define MOTION_KEYFRAME_INTERVAL  UVC_FPS   // 静止时至少每秒发送一帧，保证新客户端有画面
+
+// 亮度统计与板上自动曝光（替代摄像头内置自动曝光，低照度下不降帧）
+static int ae_target = 0;
+static int ae_interval = AE_DEFAULT_INTERVAL;
+
+// 批量采集（训练数据集）：抽帧或事件前后连续帧，按批写入文件
+static const char *batch_dir = NULL;
+static int batch_frames = BATCH_DEFAULT_FRAMES;
+static int batch_every = BATCH_DEFAULT_EVERY;
+static bool batch_event = false;
+static bool batch_compress = false;
+
+// 启动计时：从进入 main 到首帧就绪
+static uint64_t startup_us = 0;
+static const char *format_cache = UVC_FORMAT_CACHE_PATH;
+
+// 稳态无内存分配检查（CAMERA_ALLOC_TRACKING 调试构建）
+#define ALLOC_WARMUP_FRAMES    (3 * UVC_FPS)   // 预热帧数，之后的帧不允许分配内存
+#define ALLOC_CHECK_EXIT_CODE  3
+
 /**
  * @brief 信号处理函数（Ctrl+C）
  */
@@ -52,16 +110,120 @@ void sigint_handler(int signum) {
 void cleanup() {
     std::cout << "执行清理操作..." << std::endl;
 
+    // 关闭控制通道
+    control_channel_close();
+
+    // 停止自动曝光调节线程（需在摄像头关闭之前）
+    auto_exposure_close();
+
     // 关闭网络流服务器
     network_stream_close();
+    if (http_initialized) {
+        http_stream_close();
+    }
+
+    // 写出最后一批并停止写盘线程
+    frame_batch_close();
 
     // 关闭摄像头
-    uvc_camera_close();
+    capture_supervisor_close();
 
     // 关闭屏幕（如果已初始化）
     if (display_initialized) {
         ips200_display_close();
     }
+
+    // 输出剩余日志
+    ring_logger_close();
+}
+
+/**
+ * @brief 初始化 IPS200 屏幕（启动时或运行中通过控制通道打开显示时调用）
+ * @return true: 屏幕可用
+ */
+static bool init_display() {
+    if (ips200_display_init("/dev/fb0") < 0) {
+        std::cerr << "警告：IPS200屏幕初始化失败！" << std::endl;
+        std::cerr << "将继续运行，但屏幕显示功能不可用。" << std::endl;
+        std::cerr << "如需屏幕显示，请检查：" << std::endl;
+        std::cerr << "  1. 设备树是否正确配置（st7789v节点）" << std::endl;
+        std::cerr << "  2. /dev/fb0 设备是否存在" << std::endl;
+        std::cerr << "  3. 屏幕硬件连接是否正常" << std::endl;
+        return false;
+    }
+
+    // 清屏并显示提示信息
+    ips200_clear();
+    display_initialized = true;
+    std::cout << "IPS200屏幕初始化成功！" << std::endl;
+    return true;
+}
+
+/**
+ * @brief 裁剪出感兴趣区域（连续存放到 roi_image）
+ */
+static const uint8_t* crop_roi(const uint8_t *image, const struct RuntimeConfig *cfg) {
+    for (int y = 0; y < cfg->roi_h; y++) {
+        memcpy(roi_image + y * cfg->roi_w,
+               image + (cfg->roi_y + y) * UVC_WIDTH + cfg->roi_x, cfg->roi_w);
+    }
+    return roi_image;
+}
+
+/**
+ * @brief 获取单调时钟（微秒）
+ */
+static uint64_t monotonic_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/**
+ * @brief 开机以来的时间（毫秒，含挂起时间）
+ */
+static uint64_t boot_time_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_BOOTTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// 摄像头初始化线程参数
+struct CameraInitTask {
+    const char *device;
+    int result;
+    uint64_t elapsed_us;
+};
+
+/**
+ * @brief 摄像头初始化线程（与屏幕、网络初始化并行）
+ */
+static void *camera_init_thread(void *arg) {
+    struct CameraInitTask *task = (struct CameraInitTask *)arg;
+    uint64_t begin_us = monotonic_us();
+    task->result = capture_supervisor_init(task->device);
+    task->elapsed_us = monotonic_us() - begin_us;
+    return NULL;
+}
+
+/**
+ * @brief 解析几何校正输出目标列表，如 "network,http,display"
+ * @return 目标位掩码，解析失败返回 -1
+ */
+static int parse_remap_sinks(const char *list) {
+    int sinks = 0;
+    char buf[64];
+    strncpy(buf, list, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+
+    for (char *tok = strtok(buf, ","); tok != NULL; tok = strtok(NULL, ",")) {
+        if (strcmp(tok, "network") == 0) sinks |= GEO_SINK_NETWORK;
+        else if (strcmp(tok, "http") == 0) sinks |= GEO_SINK_HTTP;
+        else if (strcmp(tok, "display") == 0) sinks |= GEO_SINK_DISPLAY;
+        else if (strcmp(tok, "all") == 0) sinks |= GEO_SINK_ALL;
+        else return -1;
+    }
+    return sinks;
 }
 
 /**
@@ -73,11 +235,40 @@ void show_usage(const char* program_name) {
     std::cout << "选项:" << std::endl;
     std::cout << "  --enable-display     启用IPS200屏幕显示（默认：禁用）" << std::endl;
     std::cout << "  --disable-display    禁用IPS200屏幕显示（默认）" << std::endl;
+    std::cout << "  --enable-http        启用HTTP服务，浏览器查看MJPEG/WebSocket流（默认：禁用）" << std::endl;
+    std::cout << "  --http-port <端口>   HTTP服务端口（默认：" << HTTP_PORT << "）" << std::endl;
+    std::cout << "  --net-header-v2      TCP 8888 使用版本2包头（28字节，含亮度统计，需新版客户端；默认：版本1）" << std::endl;
+    std::cout << "  --rt-profile         启用实时运行配置（绑核 + SCHED_FIFO + mlockall）" << std::endl;
+    std::cout << "  --rt-cpu <核>        采集线程绑定的CPU核（默认：1，-1不绑定）" << std::endl;
+    std::cout << "  --rt-prio <优先级>   采集线程SCHED_FIFO优先级（默认：80，0为普通调度）" << std::endl;
+    std::cout << "  --rt-process-cpu <核>      处理线程（自动曝光、批量写盘）绑定的CPU核（默认：1）" << std::endl;
+    std::cout << "  --rt-process-prio <优先级> 处理线程SCHED_FIFO优先级（默认：70）" << std::endl;
+    std::cout << "  --rt-network-cpu <核>      网络线程（HTTP服务）绑定的CPU核（默认：0）" << std::endl;
+    std::cout << "  --rt-network-prio <优先级> 网络线程SCHED_FIFO优先级（默认：60）" << std::endl;
+    std::cout << "  --no-mlock           实时配置下不锁定内存" << std::endl;
+    std::cout << "  --remap <标定文件>   启用畸变校正/鸟瞰图透视变换" << std::endl;
+    std::cout << "  --remap-sinks <列表> 使用校正图像的输出：network,http,display,all（默认：all）" << std::endl;
+    std::cout << "  --remap-nearest      几何校正使用最近邻插值（默认：双线性）" << std::endl;
+    std::cout << "  --control-socket <路径>  运行时控制通道路径（默认：" << CONTROL_SOCKET_PATH << "）" << std::endl;
+    std::cout << "  --no-control         禁用运行时控制通道" << std::endl;
+    std::cout << "  --motion-skip        画面无变化时跳过网络发送（静止场景节省带宽）" << std::endl;
+    std::cout << "  --motion-threshold <值>  变化检测块内平均灰度差阈值 0-255（默认：" << MOTION_DEFAULT_TILE_THRESHOLD << "）" << std::endl;
+    std::cout << "  --auto-exposure      启用板上自动曝光（目标亮度 " << AE_DEFAULT_TARGET << "，曝光不超过帧周期）" << std::endl;
+    std::cout << "  --ae-target <亮度>   自动曝光目标平均亮度 1-255（同时启用自动曝光）" << std::endl;
+    std::cout << "  --ae-interval <N>    每N帧统计一次亮度直方图（默认：" << AE_DEFAULT_INTERVAL << "）" << std::endl;
+    std::cout << "  --batch-dir <目录>   启用批量采集，批文件写入该目录（供训练数据加载）" << std::endl;
+    std::cout << "  --batch-size <K>     每批帧数（默认：" << BATCH_DEFAULT_FRAMES << "，最大 " << BATCH_MAX_FRAMES << "）" << std::endl;
+    std::cout << "  --batch-every <N>    每N帧抽取一帧（默认：" << BATCH_DEFAULT_EVERY << "，0为不抽帧）" << std::endl;
+    std::cout << "  --batch-event        检测到画面变化时连续记录（含前 " << BATCH_PREROLL_FRAMES << " 帧、后 " << BATCH_POSTROLL_FRAMES << " 帧）" << std::endl;
+    std::cout << "  --batch-compress     批文件使用 zlib 压缩（需 zlib 构建）" << std::endl;
+    std::cout << "  --format-cache <路径>  摄像头协商格式缓存文件（默认：" << UVC_FORMAT_CACHE_PATH << "）" << std::endl;
+    std::cout << "  --no-format-cache    每次启动完整探测摄像头格式，不读写缓存" << std::endl;
     std::cout << "  -h, --help           显示此帮助信息" << std::endl;
     std::cout << std::endl;
     std::cout << "示例:" << std::endl;
     std::cout << "  " << program_name << "                    # 仅网络传输（推荐，性能最佳）" << std::endl;
     std::cout << "  " << program_name << " --enable-display  # 同时显示到IPS200屏幕" << std::endl;
+    std::cout << "  " << program_name << " --rt-profile --rt-cpu 1  # 采集线程独占CPU1（需root）" << std::endl;
     std::cout << std::endl;
     std::cout << "说明:" << std::endl;
     std::cout << "  禁用屏幕显示可以节省约30%的CPU资源，提高网络传输帧率。" << std::endl;
@@ -85,12 +276,87 @@ void show_usage(const char* program_name) {
 }
 
 int main(int argc, char** argv) {
+    startup_us = monotonic_us();
+    rt_profile_default_config(&rt_config);
+
     // 解析命令行参数
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "--enable-display") == 0) {
             enable_display = true;
         } else if (strcmp(argv[i], "--disable-display") == 0) {
             enable_display = false;
+        } else if (strcmp(argv[i], "--enable-http") == 0) {
+            enable_http = true;
+        } else if (strcmp(argv[i], "--http-port") == 0 && i + 1 < argc) {
+            http_port = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--net-header-v2") == 0) {
+            net_header_v2 = true;
+        } else if (strcmp(argv[i], "--rt-profile") == 0) {
+            rt_config.enabled = true;
+        } else if (strcmp(argv[i], "--rt-cpu") == 0 && i + 1 < argc) {
+            rt_config.cpu[RT_ROLE_CAPTURE] = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--rt-prio") == 0 && i + 1 < argc) {
+            rt_config.priority[RT_ROLE_CAPTURE] = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--rt-process-cpu") == 0 && i + 1 < argc) {
+            rt_config.cpu[RT_ROLE_PROCESS] = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--rt-process-prio") == 0 && i + 1 < argc) {
+            rt_config.priority[RT_ROLE_PROCESS] = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--rt-network-cpu") == 0 && i + 1 < argc) {
+            rt_config.cpu[RT_ROLE_NETWORK] = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--rt-network-prio") == 0 && i + 1 < argc) {
+            rt_config.priority[RT_ROLE_NETWORK] = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--no-mlock") == 0) {
+            rt_config.lock_memory = false;
+        } else if (strcmp(argv[i], "--remap") == 0 && i + 1 < argc) {
+            remap_calib = argv[++i];
+        } else if (strcmp(argv[i], "--remap-sinks") == 0 && i + 1 < argc) {
+            remap_sinks = parse_remap_sinks(argv[++i]);
+            if (remap_sinks < 0) {
+                std::cerr << "错误：无效的输出列表 '" << argv[i] << "'" << std::endl;
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--remap-nearest") == 0) {
+            remap_interp = GEO_INTERP_NEAREST;
+        } else if (strcmp(argv[i], "--control-socket") == 0 && i + 1 < argc) {
+            control_socket = argv[++i];
+        } else if (strcmp(argv[i], "--no-control") == 0) {
+            control_socket = NULL;
+        } else if (strcmp(argv[i], "--motion-skip") == 0) {
+            motion_skip = true;
+        } else if (strcmp(argv[i], "--motion-threshold") == 0 && i + 1 < argc) {
+            char *end = NULL;
+            long value = strtol(argv[++i], &end, 10);
+            if (end == argv[i] || *end != '\0' || value < 0 || value > 255) {
+                std::cerr << "错误：变化检测阈值需为 0-255 的整数，收到 '" << argv[i] << "'" << std::endl;
+                return 1;
+            }
+            motion_threshold = (int)value;
+        } else if (strcmp(argv[i], "--auto-exposure") == 0) {
+            ae_target = AE_DEFAULT_TARGET;
+        } else if (strcmp(argv[i], "--ae-target") == 0 && i + 1 < argc) {
+            ae_target = atoi(argv[++i]);
+            if (ae_target < 1 || ae_target > 255) {
+                std::cerr << "错误：目标亮度需在 1-255 之间" << std::endl;
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--ae-interval") == 0 && i + 1 < argc) {
+            ae_interval = atoi(argv[++i]);
+            if (ae_interval < 1) ae_interval = 1;
+        } else if (strcmp(argv[i], "--batch-dir") == 0 && i + 1 < argc) {
+            batch_dir = argv[++i];
+        } else if (strcmp(argv[i], "--batch-size") == 0 && i + 1 < argc) {
+            batch_frames = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--batch-every") == 0 && i + 1 < argc) {
+            batch_every = atoi(argv[++i]);
+            if (batch_every < 0) batch_every = 0;
+        } else if (strcmp(argv[i], "--batch-event") == 0) {
+            batch_event = true;
+        } else if (strcmp(argv[i], "--batch-compress") == 0) {
+            batch_compress = true;
+        } else if (strcmp(argv[i], "--format-cache") == 0 && i + 1 < argc) {
+            format_cache = argv[++i];
+        } else if (strcmp(argv[i], "--no-format-cache") == 0) {
+            format_cache = NULL;
         } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
             show_usage(argv[0]);
             return 0;
@@ -108,41 +374,89 @@ int main(int argc, char** argv) {
     std::cout << "配置：" << std::endl;
     std::cout << "  - 网络传输: 启用" << std::endl;
     std::cout << "  - IPS200显示: " << (enable_display ? "启用" : "禁用（节省资源）") << std::endl;
+    std::cout << "  - HTTP浏览器查看: " << (enable_http ? "启用" : "禁用") << std::endl;
+    std::cout << "  - 实时运行配置: " << (rt_config.enabled ? "启用" : "禁用") << std::endl;
+    std::cout << "  - 几何校正: " << (remap_calib ? remap_calib : "禁用") << std::endl;
+    std::cout << "  - 静止帧跳过: " << (motion_skip ? "启用" : "禁用") << std::endl;
+    std::cout << "  - 板上自动曝光: ";
+    if (ae_target > 0) {
+        std::cout << "启用（目标亮度 " << ae_target << "）" << std::endl;
+    } else {
+        std::cout << "禁用" << std::endl;
+    }
+    std::cout << "  - 批量采集: " << (batch_dir ? batch_dir : "禁用") << std::endl;
+    std::cout << "  - 摄像头格式缓存: " << (format_cache ? format_cache : "禁用") << std::endl;
+    std::cout << "  - 控制通道: " << (control_socket ? control_socket : "禁用") << std::endl;
+#ifdef CAMERA_ALLOC_TRACKING
+    std::cout << "  - 内存分配检查: 启用（预热 " << ALLOC_WARMUP_FRAMES << " 帧后不允许分配）" << std::endl;
+#endif
     std::cout << "========================================" << std::endl;
 
+    // 实时运行配置需在创建工作线程之前记录，各线程启动时应用自己的角色
+    rt_profile_init(&rt_config);
+
+    // 主循环中的日志由独立线程格式化输出，采集线程不分配内存、不阻塞在终端输出上
+    if (ring_logger_init() < 0) {
+        std::cerr << "警告：日志线程启动失败，日志将直接输出" << std::endl;
+    }
+
     // 注册清理函数
     atexit(cleanup);
 
     // 注册信号处理函数
     signal(SIGINT, sigint_handler);
 
-    int step = 1;
+    // 1. 并行初始化：摄像头格式协商最耗时，放到独立线程，屏幕、网络与几何校正表在主线程同时完成
+    std::cout << "\n正在初始化设备（摄像头与屏幕/网络并行）..." << std::endl;
+    uint64_t init_start_us = monotonic_us();
+
+    // HTTP MJPEG 直接转发摄像头JPEG数据，无需重新编码
+    uvc_camera_set_jpeg_passthrough(enable_http);
+    uvc_camera_set_format_cache(format_cache);
+    struct CameraInitTask camera_task;
+    camera_task.device = "/dev/video0";
+    camera_task.result = -1;
+    camera_task.elapsed_us = 0;
+    pthread_t camera_thread;
+    bool camera_threaded = pthread_create(&camera_thread, NULL, camera_init_thread, &camera_task) == 0;
+    if (!camera_threaded) {
+        camera_init_thread(&camera_task);
+    }
 
-    // 1. 初始化 IPS200 屏幕（可选）
+    // IPS200 屏幕（可选）
     if (enable_display) {
-        std::cout << "\n[" << step++ << "/3] 正在初始化 IPS200 屏幕..." << std::endl;
-        if (ips200_display_init("/dev/fb0") < 0) {
-            std::cerr << "警告：IPS200屏幕初始化失败！" << std::endl;
-            std::cerr << "将继续运行，但屏幕显示功能不可用。" << std::endl;
-            std::cerr << "如需屏幕显示，请检查：" << std::endl;
-            std::cerr << "  1. 设备树是否正确配置（st7789v节点）" << std::endl;
-            std::cerr << "  2. /dev/fb0 设备是否存在" << std::endl;
-            std::cerr << "  3. 屏幕硬件连接是否正常" << std::endl;
+        if (!init_display()) {
             enable_display = false;  // 禁用显示功能
-        } else {
-            // 清屏并显示提示信息
-            ips200_clear();
-            display_initialized = true;
-            std::cout << "IPS200屏幕初始化成功！" << std::endl;
         }
     } else {
-        std::cout << "\n提示：IPS200显示已禁用，节省CPU资源以提高网络传输性能。" << std::endl;
-        std::cout << "      如需启用屏幕显示，请使用参数：--enable-display" << std::endl;
+        std::cout << "提示：IPS200显示已禁用，节省CPU资源以提高网络传输性能。" << std::endl;
+        std::cout << "      如需启用屏幕显示，请使用参数：--enable-display，或运行中发送控制命令 display on" << std::endl;
+    }
+
+    // 网络流服务器
+    int network_result = network_stream_init(NETWORK_PORT);
+    network_stream_set_extended_header(net_header_v2);
+    if (network_result == 0 && enable_http) {
+        if (http_stream_init(http_port) < 0) {
+            std::cerr << "警告：HTTP服务器启动失败，浏览器查看不可用" << std::endl;
+        } else {
+            http_initialized = true;
+        }
+    }
+
+    // 几何校正：启动时一次性加载标定并生成重映射表
+    if (remap_calib != NULL && geo_remap_init(remap_calib, UVC_WIDTH, UVC_HEIGHT) < 0) {
+        std::cerr << "警告：几何校正初始化失败，输出原始图像" << std::endl;
+        remap_calib = NULL;
     }
 
-    // 2. 初始化 UVC 摄像头
-    std::cout << "\n[" << step++ << "/3] 正在初始化 USB 摄像头..." << std::endl;
-    if (uvc_camera_init("/dev/video0") < 0) {
+    // 等待摄像头初始化完成
+    if (camera_threaded) {
+        pthread_join(camera_thread, NULL);
+    }
+    uint64_t init_elapsed_us = monotonic_us() - init_start_us;
+
+    if (camera_task.result < 0) {
         std::cerr << "错误：USB摄像头初始化失败！" << std::endl;
         std::cerr << "请检查：" << std::endl;
         std::cerr << "  1. USB摄像头是否已插入" << std::endl;
@@ -150,11 +464,10 @@ int main(int argc, char** argv) {
         std::cerr << "  3. 摄像头驱动是否加载（lsmod | grep uvc）" << std::endl;
         return -1;
     }
-    std::cout << "USB摄像头初始化成功！" << std::endl;
+    std::cout << "USB摄像头初始化成功！（" << camera_task.elapsed_us / 1000 << " ms，"
+              << (uvc_camera_format_cached() ? "使用缓存格式" : "完整探测") << "）" << std::endl;
 
-    // 3. 初始化网络流服务器
-    std::cout << "\n[" << step++ << "/3] 正在初始化网络流服务器..." << std::endl;
-    if (network_stream_init(NETWORK_PORT) < 0) {
+    if (network_result < 0) {
         std::cerr << "错误：网络流服务器初始化失败！" << std::endl;
         std::cerr << "请检查：" << std::endl;
         std::cerr << "  1. 端口 " << NETWORK_PORT << " 是否被占用" << std::endl;
@@ -163,69 +476,303 @@ int main(int argc, char** argv) {
     }
     std::cout << "网络流服务器启动成功，端口: " << NETWORK_PORT << std::endl;
     std::cout << "等待电脑客户端连接..." << std::endl;
+    std::cout << "设备初始化完成，耗时 " << init_elapsed_us / 1000 << " ms" << std::endl;
+
+    // 自动曝光线程始终启动（关闭状态不修改摄像头），便于运行中通过控制通道开启
+    if (auto_exposure_init(UVC_FPS) < 0 || auto_exposure_set_target(ae_target) < 0) {
+        if (ae_target > 0) {
+            std::cerr << "警告：板上自动曝光不可用，使用摄像头默认曝光" << std::endl;
+        }
+        ae_target = 0;
+    }
+
+    // 批量采集：缓冲在启动时一次分配，主循环只拷贝被选中的帧
+    if (batch_dir != NULL) {
+        struct FrameBatchConfig batch_config;
+        memset(&batch_config, 0, sizeof(batch_config));
+        batch_config.dir = batch_dir;
+        batch_config.width = UVC_WIDTH;
+        batch_config.height = UVC_HEIGHT;
+        batch_config.batch_frames = batch_frames;
+        batch_config.sample_every = batch_every;
+        batch_config.event_trigger = batch_event;
+        batch_config.compress = batch_compress;
+        if (frame_batch_init(&batch_config) < 0) {
+            std::cerr << "警告：批量采集初始化失败，不保存数据集" << std::endl;
+            batch_dir = NULL;
+        }
+    }
+
+    // 变化检测（静止帧跳过与批量采集事件触发共用）
+    // 初始化失败时退回到逐帧发送
+    bool motion_enabled = motion_skip || (batch_dir != NULL && batch_event);
+    if (motion_enabled && motion_detect_init(UVC_WIDTH, UVC_HEIGHT, motion_threshold) < 0) {
+        std::cerr << "警告：变化检测初始化失败，将发送所有帧" << std::endl;
+        motion_enabled = false;
+        motion_skip = false;
+    }
+
+    // 运行时控制通道：初始配置来自命令行，之后通过快照发布到主循环
+    struct RuntimeConfig initial_config;
+    memset(&initial_config, 0, sizeof(initial_config));
+    initial_config.display_enabled = enable_display;
+    initial_config.exposure = -1;
+    initial_config.gain = -1;
+    initial_config.ae_target = ae_target;
+    if (control_channel_init(control_socket, &initial_config) < 0) {
+        std::cerr << "警告：控制通道启动失败，运行中无法修改参数" << std::endl;
+    }
+
+    // 所有线程创建、设备初始化完成后，主线程再应用采集角色并锁定内存
+    // 权限不足时仅打印警告，程序继续以普通模式运行
+    if (rt_profile_apply_thread(RT_ROLE_CAPTURE) != 0 || rt_profile_lock_memory() != 0) {
+        std::cerr << "警告：实时运行配置未完全生效，帧间抖动可能增大" << std::endl;
+    }
 
     // 4. 主循环：采集图像并传输/显示
     std::cout << "\n开始采集并传输图像..." << std::endl;
     std::cout << "按 Ctrl+C 退出程序\n" << std::endl;
 
     int frame_count = 0;
-    time_t start_time = time(NULL);
+    time_t last_report_time = time(NULL);
+    int last_report_frames = 0;
+    int no_signal_count = 0;
+    int frames_since_sent = 0;
+    int skipped_count = 0;
+    bool scene_moving = false;
+    uint32_t applied_generation = 0;
+    uint64_t next_output_us = 0;
+    struct LumaStats luma;
+    bool luma_valid = false;
+    struct MotionResult motion;
+    int luma_countdown = 0;
+    bool first_frame_reported = false;
+    uint64_t devices_ready_us = monotonic_us();
+    struct AllocCounts alloc_counts;
+    bool alloc_frame_steady = false;
+    bool alloc_check_failed = false;
+    int alloc_checked_frames = 0;
+    uint64_t alloc_external_total = 0;
 
     while (running) {
-        // 等待并采集新的图像帧
-        if (wait_image_refresh() < 0) {
-            std::cerr << "警告：图像采集失败！" << std::endl;
-
-            // 如果连续失败，则退出
-            static int fail_count = 0;
-            if (++fail_count > 10) {
-                std::cerr << "错误：摄像头采集连续失败，程序退出" << std::endl;
+        // 上一帧的内存分配检查（配置变更、掉线恢复的帧不属于稳态，不计入）
+        alloc_tracker_frame_end(&alloc_counts);
+        if (alloc_frame_steady && ++alloc_checked_frames > ALLOC_WARMUP_FRAMES) {
+            alloc_external_total += alloc_counts.external;
+            if (alloc_counts.own > 0) {
+                ring_log_error("错误：稳态第%d帧发生 %u 次内存分配\n",
+                               alloc_checked_frames - ALLOC_WARMUP_FRAMES, alloc_counts.own);
+                alloc_check_failed = true;
                 break;
             }
+        }
+        alloc_tracker_frame_begin();
+        alloc_frame_steady = true;
 
-            usleep(100000);  // 等待100ms后重试
-            continue;
+        // 获取最新配置快照（无锁），上一轮的快照在此之后可被控制线程回收
+        control_config_quiescent();
+        const struct RuntimeConfig *cfg = control_config_acquire();
+
+        // 配置变更：只在版本号变化时处理
+        if (cfg->generation != applied_generation) {
+            applied_generation = cfg->generation;
+            alloc_frame_steady = false;
+            if (cfg->display_enabled && !display_initialized) {
+                init_display();
+            }
+            enable_display = cfg->display_enabled && display_initialized;
+            if (http_initialized) {
+                http_stream_set_default_jpeg(cfg->ws_jpeg);
+            }
         }
 
-        // 获取灰度图像数据
-        uint8_t* gray_image = get_gray_image();
-        if (gray_image == NULL) {
-            std::cerr << "警告：无法获取灰度图像数据" << std::endl;
-            continue;
+        // 采集新的图像帧；摄像头掉线时返回"无信号"帧，网络客户端与显示保持连接
+        uint8_t* gray_image = NULL;
+        enum CaptureStatus status = capture_supervisor_next_frame(&gray_image);
+        bool no_signal = (status == CAPTURE_NO_SIGNAL);
+
+        // 设备重新打开后恢复曝光/增益设置
+        if (status == CAPTURE_RECOVERED) {
+            control_channel_apply_camera();
+        }
+        // 首帧就绪时间：衡量开机到出图的总延迟
+        if (!first_frame_reported && !no_signal) {
+            first_frame_reported = true;
+            uint64_t now_us = monotonic_us();
+            ring_log("首帧就绪: 程序启动后 %d ms（设备初始化 %d ms，摄像头 %s，首帧等待 %d ms），开机后 %d ms\n",
+                     (int)((now_us - startup_us) / 1000), (int)(init_elapsed_us / 1000),
+                     uvc_camera_format_cached() ? "缓存格式" : "完整探测",
+                     (int)((now_us - devices_ready_us) / 1000), (int)boot_time_ms());
+        }
+        if (status != CAPTURE_OK) {
+            // 掉线期间及恢复后重新预热
+            alloc_frame_steady = false;
+            alloc_checked_frames = 0;
+        }
+
+        // 亮度统计：每N帧一次，供自动曝光调节与网络客户端元数据使用（在帧率上限之前，调节不受输出降帧影响）
+        bool luma_wanted = cfg->ae_target > 0 || http_initialized || batch_dir != NULL ||
+                           (net_header_v2 && network_stream_get_clients() > 0);
+        if (!no_signal && luma_wanted && --luma_countdown <= 0) {
+            luma_countdown = ae_interval;
+            luma_stats_compute(gray_image, UVC_WIDTH * UVC_HEIGHT, &luma);
+            luma_valid = true;
+            auto_exposure_update(&luma);
+        }
+
+        // 输出帧率上限：采集保持全速，超出上限的帧只跳过屏幕显示与网络发送，
+        // 帧计数、变化检测、批量采集与统计照常进行
+        bool output_due = true;
+        if (cfg->fps_cap > 0) {
+            uint64_t now_us = monotonic_us();
+            if (now_us < next_output_us) {
+                output_due = false;
+            } else {
+                uint64_t period_us = 1000000 / cfg->fps_cap;
+                next_output_us = (now_us - next_output_us < period_us) ? next_output_us + period_us
+                                                                       : now_us + period_us;
+            }
         }
 
+        // 几何校正：各输出按配置选择原始或校正后的图像
+        uint8_t* corrected_image = gray_image;
+        if (remap_calib != NULL && !no_signal && (output_due || batch_dir != NULL)) {
+            geo_remap_apply(gray_image, remap_image, remap_interp);
+            corrected_image = remap_image;
+        }
+        uint8_t* display_image = (remap_sinks & GEO_SINK_DISPLAY) ? corrected_image : gray_image;
+        const uint8_t* network_image = (remap_sinks & GEO_SINK_NETWORK) ? corrected_image : gray_image;
+        const uint8_t* http_image = (remap_sinks & GEO_SINK_HTTP) ? corrected_image : gray_image;
+
         // 显示图像到 IPS200 屏幕（如果启用）
-        if (enable_display && display_initialized) {
+        if (output_due && enable_display && display_initialized) {
             // 图像居中显示：(240-160)/2=40, (320-120)/2=100
-            ips200_show_gray_image(40, 100, gray_image, UVC_WIDTH, UVC_HEIGHT);
+            ips200_show_gray_image(40, 100, display_image, UVC_WIDTH, UVC_HEIGHT);
+        }
+
+        // 变化检测：画面无变化时跳过本帧网络发送
+        bool send_frame = true;
+        bool motion_valid = false;
+        if (motion_enabled && !no_signal) {
+            if (motion_detect_process(gray_image, &motion) == 0) {
+                motion_valid = true;
+                if (motion.changed != scene_moving) {
+                    scene_moving = motion.changed;
+                    ring_log("%s（变化块 %d/%d）\n",
+                             scene_moving ? "检测到画面变化" : "画面恢复静止",
+                             motion.dirty_count, motion.tiles_x * motion.tiles_y);
+                }
+                if (motion_skip) {
+                    send_frame = motion.changed || frames_since_sent >= MOTION_KEYFRAME_INTERVAL;
+                    if (output_due && send_frame && !motion.changed) {
+                        // 关键帧发送整帧：参考帧同步为客户端当前看到的画面，避免缓慢漂移累积
+                        motion_detect_set_reference(gray_image);
+                    }
+                }
+            }
         }
 
-        // 发送图像到网络客户端
-        int clients = network_stream_send(gray_image, UVC_WIDTH, UVC_HEIGHT);
+        // 批量采集：与网络发送使用同一图像（完整画面），不受静止帧跳过影响
+        if (batch_dir != NULL && !no_signal) {
+            struct BatchFrameInfo batch_info;
+            batch_info.frame_index = frame_count;
+            batch_info.timestamp_us = monotonic_us();
+            batch_info.event = motion_valid && motion.changed;
+            batch_info.motion_score = motion_valid ? motion.score : 0;
+            batch_info.luma_mean = luma_valid ? luma.mean : 0;
+            frame_batch_submit(network_image, &batch_info);
+        }
+
+        // 发送图像到网络客户端（可选裁剪感兴趣区域）
+        int clients = 0;
+        if (output_due && send_frame) {
+            uint16_t out_width = UVC_WIDTH;
+            uint16_t out_height = UVC_HEIGHT;
+            bool roi = cfg->roi_w > 0 && cfg->roi_h > 0;
+            if (roi) {
+                out_width = cfg->roi_w;
+                out_height = cfg->roi_h;
+            }
+
+            const LumaStats *frame_luma = (luma_valid && !no_signal) ? &luma : NULL;
+            clients = network_stream_send(roi ? crop_roi(network_image, cfg) : network_image,
+                                          out_width, out_height, frame_luma);
+            if (http_initialized) {
+                // 校正/裁剪后的图像与摄像头原始JPEG不一致，此时由HTTP线程重新编码
+                uint32_t jpeg_size = 0;
+                const uint8_t *jpeg = (no_signal || roi || http_image != gray_image) ? NULL : get_jpeg_image(&jpeg_size);
+                if (roi) {
+                    http_image = crop_roi(http_image, cfg);
+                }
+                http_stream_publish(http_image, out_width, out_height, jpeg, jpeg_size, frame_luma);
+                clients += http_stream_get_clients();
+            }
+            frames_since_sent = 0;
+        } else {
+            // 帧率上限跳过的帧同样计入关键帧间隔，但不计为静止帧
+            frames_since_sent++;
+            if (output_due) {
+                skipped_count++;
+            }
+        }
         if (clients > 0 && frame_count % 30 == 0) {
             // 每30帧提示一次客户端连接数
-            std::cout << "网络客户端数: " << clients << std::endl;
-        }
-
-        // 统计帧率
-        frame_count++;
-        if (frame_count % 30 == 0) {
-            time_t current_time = time(NULL);
-            double elapsed = difftime(current_time, start_time);
-            if (elapsed > 0) {
-                double fps = frame_count / elapsed;
-                std::cout << "实时帧率: " << fps << " FPS, 总帧数: "
-                         << frame_count;
-                if (enable_display) {
-                    std::cout << " (含屏幕显示)";
-                } else {
-                    std::cout << " (仅网络传输)";
-                }
-                std::cout << std::endl;
+            ring_log("网络客户端数: %d\n", clients);
+        }
+
+        // 统计帧率："无信号"帧不计入帧数，但掉线期间每秒的统计与实时报告照常输出
+        if (no_signal) {
+            no_signal_count++;
+        } else {
+            frame_count++;
+        }
+        time_t current_time = time(NULL);
+        if (current_time != last_report_time) {
+            double elapsed = difftime(current_time, last_report_time);
+            double fps = (frame_count - last_report_frames) / elapsed;
+            const char *mode = enable_display ? "含屏幕显示" : "仅网络传输";
+            if (no_signal) {
+                ring_log("摄像头掉线中: 已中断 %u ms, 无信号帧: %d, 总帧数: %d\n",
+                         capture_supervisor_last_outage_ms(), no_signal_count, frame_count);
+            } else if (motion_skip) {
+                ring_log("实时帧率: %.1f FPS, 总帧数: %d (%s), 跳过静止帧: %d\n",
+                         fps, frame_count, mode, skipped_count);
+            } else {
+                ring_log("实时帧率: %.1f FPS, 总帧数: %d (%s)\n", fps, frame_count, mode);
+            }
+            if (!no_signal && cfg->ae_target > 0 && luma_valid) {
+                int exposure, gain;
+                auto_exposure_get_state(&exposure, &gain);
+                ring_log("亮度: %d (p5 %d, p95 %d), 曝光: %d, 增益: %d\n",
+                         luma.mean, luma.p5, luma.p95, exposure, gain);
             }
+
+            // 缺页与上下文切换统计
+            if (rt_config.enabled) {
+                rt_profile_report();
+            }
+            last_report_time = current_time;
+            last_report_frames = frame_count;
         }
     }
 
+    motion_detect_close();
+    geo_remap_close();
+
+    if (alloc_check_failed) {
+        std::cerr << "内存分配检查失败：稳态采集循环中发生了内存分配" << std::endl;
+        return ALLOC_CHECK_EXIT_CODE;
+    }
+#ifdef CAMERA_ALLOC_TRACKING
+    int steady_frames = alloc_checked_frames - ALLOC_WARMUP_FRAMES;
+    if (steady_frames > 0) {
+        std::cout << "内存分配检查通过：稳态 " << steady_frames << " 帧无分配（JPEG解码库内部平均 "
+                  << (double)alloc_external_total / steady_frames << " 次/帧）" << std::endl;
+    } else {
+        std::cout << "内存分配检查未完成：运行帧数不足 " << ALLOC_WARMUP_FRAMES << " 帧预热" << std::endl;
+    }
+#endif
+
     std::cout << "\n程序正常退出，总共处理 " << frame_count << " 帧图像" << std::endl;
     return 0;
 }
@@ -0,0 +1,156 @@
+#include "motion_detect.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#else
+#include "simd_vec.h"
+#endif
+
+// 纵向降采样步长：每块只比较偶数行（16x4 = 64 个采样点）
+#define MOTION_ROW_STEP       2
+#define MOTION_TILE_SAMPLES   (MOTION_TILE_W * MOTION_TILE_H / MOTION_ROW_STEP)
+
+// 内部状态
+static uint8_t *reference = NULL;
+static uint16_t img_width = 0;
+static uint16_t img_height = 0;
+static uint16_t tiles_x = 0;
+static uint16_t tiles_y = 0;
+static uint32_t tile_sad_threshold = 0;
+static bool has_reference = false;
+
+/**
+ * @brief 计算一个16x8块的降采样SAD
+ */
+static uint32_t tile_sad(const uint8_t *cur, const uint8_t *ref, int stride) {
+#if defined(__SSE2__)
+    __m128i acc = _mm_setzero_si128();
+    for (int y = 0; y < MOTION_TILE_H; y += MOTION_ROW_STEP) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(cur + y * stride));
+        __m128i b = _mm_loadu_si128((const __m128i *)(ref + y * stride));
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(a, b));
+    }
+    // 两个64位通道各保存8字节的和
+    return (uint32_t)(_mm_cvtsi128_si32(acc) +
+                      _mm_cvtsi128_si32(_mm_srli_si128(acc, 8)));
+#elif defined(SIMD_VEC_AVAILABLE)
+    // 每行16字节绝对差，相邻字节合并到16位通道累加（4行最大 4x510，不溢出）
+    vec_u16x8 acc = {0, 0, 0, 0, 0, 0, 0, 0};
+    for (int y = 0; y < MOTION_TILE_H; y += MOTION_ROW_STEP) {
+        vec_u8x16 d = vec_absdiff_u8(vec_load_u8(cur + y * stride), vec_load_u8(ref + y * stride));
+        acc += vec_pairsum_u8(d);
+    }
+    return vec_hsum_u16(acc);
+#else
+    uint32_t sad = 0;
+    for (int y = 0; y < MOTION_TILE_H; y += MOTION_ROW_STEP) {
+        const uint8_t *a = cur + y * stride;
+        const uint8_t *b = ref + y * stride;
+        for (int x = 0; x < MOTION_TILE_W; x++) {
+            int d = a[x] - b[x];
+            sad += (d < 0) ? -d : d;
+        }
+    }
+    return sad;
+#endif
+}
+
+/**
+ * @brief 将一个块从当前帧复制到参考帧
+ */
+static void copy_tile(uint8_t *dst, const uint8_t *src, int stride) {
+    for (int y = 0; y < MOTION_TILE_H; y++) {
+        memcpy(dst + y * stride, src + y * stride, MOTION_TILE_W);
+    }
+}
+
+int motion_detect_init(uint16_t width, uint16_t height, uint8_t tile_threshold) {
+    if (width == 0 || height == 0 ||
+        width % MOTION_TILE_W != 0 || height % MOTION_TILE_H != 0 ||
+        width / MOTION_TILE_W > MOTION_MAX_TILES_X ||
+        height / MOTION_TILE_H > MOTION_MAX_TILES_Y) {
+        fprintf(stderr, "变化检测不支持的图像尺寸: %dx%d\n", width, height);
+        return -1;
+    }
+
+    motion_detect_close();
+
+    reference = (uint8_t *)malloc((size_t)width * height);
+    if (reference == NULL) {
+        perror("变化检测参考帧分配失败");
+        return -1;
+    }
+
+    img_width = width;
+    img_height = height;
+    tiles_x = width / MOTION_TILE_W;
+    tiles_y = height / MOTION_TILE_H;
+    tile_sad_threshold = (uint32_t)tile_threshold * MOTION_TILE_SAMPLES;
+    has_reference = false;
+
+    printf("变化检测已启用: %dx%d 块, 阈值 %d\n", tiles_x, tiles_y, tile_threshold);
+    return 0;
+}
+
+int motion_detect_process(const uint8_t *image, struct MotionResult *result) {
+    if (reference == NULL || image == NULL || result == NULL) {
+        return -1;
+    }
+
+    result->tiles_x = tiles_x;
+    result->tiles_y = tiles_y;
+
+    // 第一帧：全部视为变化
+    if (!has_reference) {
+        motion_detect_set_reference(image);
+        memset(result->dirty, 1, tiles_x * tiles_y);
+        result->dirty_count = tiles_x * tiles_y;
+        result->score = 255 << 8;
+        result->changed = true;
+        return 0;
+    }
+
+    uint64_t total_sad = 0;
+    uint16_t dirty_count = 0;
+
+    for (int ty = 0; ty < tiles_y; ty++) {
+        for (int tx = 0; tx < tiles_x; tx++) {
+            size_t offset = (size_t)ty * MOTION_TILE_H * img_width + tx * MOTION_TILE_W;
+            uint32_t sad = tile_sad(image + offset, reference + offset, img_width);
+            total_sad += sad;
+
+            bool dirty = sad > tile_sad_threshold;
+            result->dirty[ty * tiles_x + tx] = dirty ? 1 : 0;
+            if (dirty) {
+                // 只更新变化块，参考帧与"接收端已有图像"保持一致
+                copy_tile(reference + offset, image + offset, img_width);
+                dirty_count++;
+            }
+        }
+    }
+
+    uint32_t total_samples = (uint32_t)tiles_x * tiles_y * MOTION_TILE_SAMPLES;
+    result->score = (uint32_t)((total_sad << 8) / total_samples);
+    result->dirty_count = dirty_count;
+    result->changed = dirty_count > 0;
+    return 0;
+}
+
+void motion_detect_set_reference(const uint8_t *image) {
+    if (reference == NULL || image == NULL) {
+        return;
+    }
+    memcpy(reference, image, (size_t)img_width * img_height);
+    has_reference = true;
+}
+
+void motion_detect_close() {
+    if (reference != NULL) {
+        free(reference);
+        reference = NULL;
+    }
+    has_reference = false;
+}
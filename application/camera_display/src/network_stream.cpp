@@ -1,4 +1,5 @@
 #include "network_stream.h"
+#include "ring_logger.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -11,10 +12,13 @@
 #include <errno.h>
 #include <sys/time.h>
 
+static_assert(sizeof(ImageHeader) == 28, "ImageHeader 版本2必须为28字节");
+
 // 内部状态
 static int server_fd = -1;
 static int client_fds[MAX_CLIENTS];
 static int client_count = 0;
+static bool extended_header = false;
 
 /**
  * @brief 设置socket为非阻塞模式
@@ -102,7 +106,7 @@ static void accept_clients() {
             if (errno == EAGAIN || errno == EWOULDBLOCK) {
                 break;  // 没有新连接
             }
-            perror("accept失败");
+            ring_log_error("accept失败: %s\n", strerror(errno));
             break;
         }
 
@@ -120,10 +124,10 @@ static void accept_clients() {
             if (client_fds[i] == -1) {
                 client_fds[i] = new_fd;
                 client_count++;
-                printf("新客户端连接: %s:%d [%d/%d]\n",
-                       inet_ntoa(client_addr.sin_addr),
-                       ntohs(client_addr.sin_port),
-                       client_count, MAX_CLIENTS);
+                ring_log("新客户端连接: %s:%d [%d/%d]\n",
+                         inet_ntoa(client_addr.sin_addr),
+                         ntohs(client_addr.sin_port),
+                         client_count, MAX_CLIENTS);
                 break;
             }
         }
@@ -138,11 +142,16 @@ static void remove_client(int index) {
         close(client_fds[index]);
         client_fds[index] = -1;
         client_count--;
-        printf("客户端断开连接 [%d/%d]\n", client_count, MAX_CLIENTS);
+        ring_log("客户端断开连接 [%d/%d]\n", client_count, MAX_CLIENTS);
     }
 }
 
-int network_stream_send(const uint8_t *image, uint16_t width, uint16_t height) {
+void network_stream_set_extended_header(bool enable) {
+    extended_header = enable;
+}
+
+int network_stream_send(const uint8_t *image, uint16_t width, uint16_t height,
+                        const struct LumaStats *luma) {
     if (server_fd < 0 || image == NULL) {
         return 0;
     }
@@ -156,11 +165,18 @@ int network_stream_send(const uint8_t *image, uint16_t width, uint16_t height) {
 
     // 准备数据包头
     struct ImageHeader header;
-    header.magic = 0x12345678;
+    header.magic = extended_header ? IMAGE_MAGIC_V2 : IMAGE_MAGIC_V1;
     header.width = width;
     header.height = height;
     header.data_size = width * height;
     header.timestamp = get_timestamp_ms();
+    header.header_size = sizeof(header);
+    header.version = IMAGE_HEADER_VERSION;
+    header.luma_mean = luma ? luma->mean : 0;
+    header.luma_p5 = luma ? luma->p5 : 0;
+    header.luma_p50 = luma ? luma->p50 : 0;
+    header.luma_p95 = luma ? luma->p95 : 0;
+    const ssize_t header_len = extended_header ? sizeof(header) : IMAGE_HEADER_V1_SIZE;
 
     int sent_count = 0;
 
@@ -169,8 +185,8 @@ int network_stream_send(const uint8_t *image, uint16_t width, uint16_t height) {
         if (client_fds[i] == -1) continue;
 
         // 发送头部
-        ssize_t n = send(client_fds[i], &header, sizeof(header), MSG_NOSIGNAL);
-        if (n != sizeof(header)) {
+        ssize_t n = send(client_fds[i], &header, header_len, MSG_NOSIGNAL);
+        if (n != header_len) {
             remove_client(i);
             continue;
         }
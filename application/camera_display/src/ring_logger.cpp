@@ -0,0 +1,257 @@
+#include "ring_logger.h"
+#include <stdio.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <atomic>
+
+#define RING_LOG_LINE_MAX     512
+
+// 队列槽：sequence 等于写入位置时可写，等于写入位置+1时可读
+struct RingSlot {
+    std::atomic<size_t> sequence;
+    RingLogRecord record;
+};
+
+static RingSlot slots[RING_LOG_SLOTS];
+static std::atomic<size_t> enqueue_pos(0);
+static std::atomic<size_t> dequeue_pos(0);
+static std::atomic<uint64_t> dropped_count(0);
+
+static pthread_t logger_thread;
+static bool thread_started = false;
+static std::atomic<bool> logger_running(false);
+
+// ==================== 格式化（仅输出线程） ====================
+
+/**
+ * @brief 按记录中保存的参数类型格式化一条日志
+ * @return 输出长度
+ */
+static int format_record(const RingLogRecord *record, char *out, size_t size) {
+    const char *p = record->fmt;
+    size_t len = 0;
+    int argi = 0;
+
+    while (*p != '\0' && len + 1 < size) {
+        if (*p != '%') {
+            out[len++] = *p++;
+            continue;
+        }
+        if (p[1] == '%') {
+            out[len++] = '%';
+            p += 2;
+            continue;
+        }
+
+        // 解析 %[标志][宽度][.精度][长度]转换符，去掉长度修饰符
+        char spec[32];
+        size_t spec_len = 0;
+        const char *start = p;
+        spec[spec_len++] = *p++;
+        while (*p != '\0' && strchr("-+ #0123456789.", *p) != NULL && spec_len < sizeof(spec) - 4) {
+            spec[spec_len++] = *p++;
+        }
+        while (*p != '\0' && strchr("hlLqjzt", *p) != NULL) {
+            p++;
+        }
+        char conv = *p;
+        if (conv == '\0' || argi >= record->argc) {
+            // 参数不足或格式串不完整：原样输出
+            size_t n = (conv == '\0') ? strlen(start) : (size_t)(p - start + 1);
+            for (size_t i = 0; i < n && len + 1 < size; i++) {
+                out[len++] = start[i];
+            }
+            if (conv == '\0') break;
+            p++;
+            continue;
+        }
+        p++;
+
+        const RingLogArg *arg = &record->args[argi++];
+        int n = 0;
+        if (strchr("diouxXc", conv) != NULL) {
+            long long v = (arg->type == RING_ARG_DOUBLE) ? (long long)arg->value.d : arg->value.i;
+            if (conv == 'c') {
+                spec[spec_len++] = conv;
+                spec[spec_len] = '\0';
+                n = snprintf(out + len, size - len, spec, (int)v);
+            } else {
+                spec[spec_len++] = 'l';
+                spec[spec_len++] = 'l';
+                spec[spec_len++] = conv;
+                spec[spec_len] = '\0';
+                n = (arg->type == RING_ARG_STRING) ? snprintf(out + len, size - len, "%s", arg->value.s)
+                                                   : snprintf(out + len, size - len, spec, v);
+            }
+        } else if (strchr("fFeEgGaA", conv) != NULL) {
+            double v = (arg->type == RING_ARG_INT) ? (double)arg->value.i : arg->value.d;
+            spec[spec_len++] = conv;
+            spec[spec_len] = '\0';
+            n = (arg->type == RING_ARG_STRING) ? snprintf(out + len, size - len, "%s", arg->value.s)
+                                               : snprintf(out + len, size - len, spec, v);
+        } else {
+            // %s 及其他：字符串原样输出，数值按默认格式输出
+            spec[spec_len++] = 's';
+            spec[spec_len] = '\0';
+            if (arg->type == RING_ARG_STRING) {
+                n = snprintf(out + len, size - len, spec, arg->value.s);
+            } else if (arg->type == RING_ARG_INT) {
+                n = snprintf(out + len, size - len, "%lld", arg->value.i);
+            } else {
+                n = snprintf(out + len, size - len, "%g", arg->value.d);
+            }
+        }
+
+        if (n > 0) {
+            len += ((size_t)n < size - len) ? (size_t)n : size - len - 1;
+        }
+    }
+
+    out[len] = '\0';
+    return (int)len;
+}
+
+static void write_record(const RingLogRecord *record) {
+    char line[RING_LOG_LINE_MAX];
+    format_record(record, line, sizeof(line));
+    fputs(line, record->to_stderr ? stderr : stdout);
+}
+
+// ==================== 无锁队列 ====================
+
+void ring_logger_push(const RingLogRecord *record) {
+    if (!logger_running.load(std::memory_order_acquire)) {
+        // 输出线程未运行（初始化前/关闭后）：直接输出
+        write_record(record);
+        fflush(record->to_stderr ? stderr : stdout);
+        return;
+    }
+
+    RingSlot *slot;
+    size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+    for (;;) {
+        slot = &slots[pos & (RING_LOG_SLOTS - 1)];
+        size_t seq = slot->sequence.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // 队列已满：丢弃，不等待
+            dropped_count.fetch_add(1, std::memory_order_relaxed);
+            return;
+        } else {
+            pos = enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->record = *record;
+    slot->sequence.store(pos + 1, std::memory_order_release);
+}
+
+/**
+ * @brief 取出一条日志
+ * @return true: 取到日志
+ */
+static bool ring_logger_pop(RingLogRecord *record) {
+    RingSlot *slot;
+    size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+    for (;;) {
+        slot = &slots[pos & (RING_LOG_SLOTS - 1)];
+        size_t seq = slot->sequence.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+        if (diff == 0) {
+            if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false;  // 队列为空
+        } else {
+            pos = dequeue_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+    *record = slot->record;
+    slot->sequence.store(pos + RING_LOG_SLOTS, std::memory_order_release);
+    return true;
+}
+
+/**
+ * @brief 输出队列中的全部日志
+ * @return 输出条数
+ */
+static int drain() {
+    RingLogRecord record;
+    int count = 0;
+    while (ring_logger_pop(&record)) {
+        write_record(&record);
+        count++;
+    }
+    if (count > 0) {
+        fflush(stdout);
+        fflush(stderr);
+    }
+    return count;
+}
+
+static void *logger_loop(void *) {
+    uint64_t reported_dropped = 0;
+
+    while (logger_running.load()) {
+        if (drain() == 0) {
+            usleep(RING_LOG_FLUSH_MS * 1000);
+        }
+
+        uint64_t dropped = dropped_count.load();
+        if (dropped != reported_dropped) {
+            fprintf(stderr, "警告：日志队列已满，丢弃 %llu 条\n",
+                    (unsigned long long)(dropped - reported_dropped));
+            reported_dropped = dropped;
+        }
+    }
+
+    return NULL;
+}
+
+// ==================== 对外接口 ====================
+
+int ring_logger_init() {
+    static_assert((RING_LOG_SLOTS & (RING_LOG_SLOTS - 1)) == 0, "RING_LOG_SLOTS 必须是2的幂");
+
+    if (thread_started) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < RING_LOG_SLOTS; i++) {
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    enqueue_pos.store(0);
+    dequeue_pos.store(0);
+
+    logger_running.store(true, std::memory_order_release);
+    if (pthread_create(&logger_thread, NULL, logger_loop, NULL) != 0) {
+        perror("日志线程创建失败");
+        logger_running.store(false);
+        return -1;
+    }
+    thread_started = true;
+    return 0;
+}
+
+void ring_logger_close() {
+    if (!thread_started) {
+        return;
+    }
+
+    logger_running.store(false, std::memory_order_release);
+    pthread_join(logger_thread, NULL);
+    thread_started = false;
+
+    // 输出线程退出前后仍可能有日志入队
+    drain();
+}
+
+uint64_t ring_logger_dropped() {
+    return dropped_count.load();
+}
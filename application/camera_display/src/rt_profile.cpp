@@ -0,0 +1,178 @@
+#include "rt_profile.h"
+#include "ring_logger.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+
+// 内部状态
+static struct RtProfileConfig rt_config;
+static bool rt_configured = false;
+
+// 统计基准（采集线程自身的 RUSAGE_THREAD 计数）
+static struct rusage last_usage;
+static struct timespec last_time;
+
+static const char *role_names[RT_ROLE_COUNT] = {"采集", "处理", "网络"};
+
+void rt_profile_default_config(struct RtProfileConfig *config) {
+    memset(config, 0, sizeof(*config));
+    config->enabled = false;
+    config->cpu[RT_ROLE_CAPTURE] = 1;
+    config->cpu[RT_ROLE_PROCESS] = 1;
+    config->cpu[RT_ROLE_NETWORK] = 0;
+    config->priority[RT_ROLE_CAPTURE] = 80;
+    config->priority[RT_ROLE_PROCESS] = 70;
+    config->priority[RT_ROLE_NETWORK] = 60;
+    config->lock_memory = true;
+}
+
+void rt_profile_init(const struct RtProfileConfig *config) {
+    rt_config = *config;
+    rt_configured = true;
+
+    getrusage(RUSAGE_THREAD, &last_usage);
+    clock_gettime(CLOCK_MONOTONIC, &last_time);
+
+    if (rt_config.enabled) {
+        printf("实时运行配置已启用\n");
+    }
+}
+
+int rt_profile_apply_thread(enum RtThreadRole role) {
+    if (!rt_configured || !rt_config.enabled || role >= RT_ROLE_COUNT) {
+        return 0;
+    }
+
+    int degraded = 0;
+    int cpu = rt_config.cpu[role];
+    int priority = rt_config.priority[role];
+
+    // 绑定CPU核
+    if (cpu >= 0) {
+        long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+        if (cpu >= ncpu) {
+            fprintf(stderr, "警告：%s线程绑核失败，CPU%d 不存在（共%ld核）\n",
+                    role_names[role], cpu, ncpu);
+            degraded = 1;
+        } else {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+            if (err != 0) {
+                fprintf(stderr, "警告：%s线程绑定CPU%d失败: %s\n",
+                        role_names[role], cpu, strerror(err));
+                degraded = 1;
+            }
+        }
+    }
+
+    // 设置SCHED_FIFO实时优先级
+    if (priority > 0) {
+        int max_prio = sched_get_priority_max(SCHED_FIFO);
+        int min_prio = sched_get_priority_min(SCHED_FIFO);
+        if (priority > max_prio) priority = max_prio;
+        if (priority < min_prio) priority = min_prio;
+
+        struct sched_param param;
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = priority;
+        int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (err != 0) {
+            // 无CAP_SYS_NICE或RLIMIT_RTPRIO为0时失败，保持普通调度继续运行
+            fprintf(stderr, "警告：%s线程设置SCHED_FIFO(%d)失败: %s，保持普通调度\n",
+                    role_names[role], priority, strerror(err));
+            degraded = 1;
+        }
+    }
+
+    if (!degraded) {
+        // 只打印实际设置的项
+        char cpu_text[16] = "不绑核";
+        char sched_text[32] = "普通调度";
+        if (cpu >= 0) {
+            snprintf(cpu_text, sizeof(cpu_text), "CPU%d", cpu);
+        }
+        if (priority > 0) {
+            snprintf(sched_text, sizeof(sched_text), "SCHED_FIFO %d", priority);
+        }
+        printf("%s线程: %s, %s\n", role_names[role], cpu_text, sched_text);
+    }
+
+    // 缺页与上下文切换按线程统计：采集线程应用角色后重新记录基准
+    if (role == RT_ROLE_CAPTURE) {
+        getrusage(RUSAGE_THREAD, &last_usage);
+        clock_gettime(CLOCK_MONOTONIC, &last_time);
+    }
+    return degraded;
+}
+
+int rt_profile_lock_memory() {
+    if (!rt_configured || !rt_config.enabled || !rt_config.lock_memory) {
+        return 0;
+    }
+
+    // MCL_CURRENT 将已建立的普通映射调入内存；
+    // 显存映射（VM_IO/VM_PFNMAP）不受影响，由 ips200_display_init 映射后逐页访问预先建立页表
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0) {
+        fprintf(stderr, "警告：mlockall失败: %s，内存可能被换出\n", strerror(errno));
+        if (errno == ENOMEM || errno == EPERM) {
+            fprintf(stderr, "      请以root运行或提高 ulimit -l\n");
+        }
+        return 1;
+    }
+
+    printf("进程内存已锁定 (mlockall)\n");
+    return 0;
+}
+
+void rt_profile_prefault(void *buf, size_t len) {
+    if (buf == NULL || len == 0) {
+        return;
+    }
+
+    // 逐页读写一次，确保物理页已分配（写回原值，不改变内容）
+    long page_size = sysconf(_SC_PAGESIZE);
+    if (page_size <= 0) page_size = 4096;
+
+    volatile uint8_t *p = (volatile uint8_t *)buf;
+    for (size_t off = 0; off < len; off += page_size) {
+        p[off] = p[off];
+    }
+    p[len - 1] = p[len - 1];
+}
+
+void rt_profile_report() {
+    if (!rt_configured) {
+        return;
+    }
+
+    struct rusage usage;
+    struct timespec now;
+    getrusage(RUSAGE_THREAD, &usage);
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    double elapsed = (now.tv_sec - last_time.tv_sec) +
+                     (now.tv_nsec - last_time.tv_nsec) / 1e9;
+    if (elapsed <= 0) {
+        return;
+    }
+
+    long minflt = usage.ru_minflt - last_usage.ru_minflt;
+    long majflt = usage.ru_majflt - last_usage.ru_majflt;
+    long nvcsw  = usage.ru_nvcsw  - last_usage.ru_nvcsw;
+    long nivcsw = usage.ru_nivcsw - last_usage.ru_nivcsw;
+
+    ring_log("采集线程缺页: %.1f/s (主 %.1f/s), 上下文切换: 自愿 %.1f/s, 抢占 %.1f/s\n",
+             minflt / elapsed, majflt / elapsed, nvcsw / elapsed, nivcsw / elapsed);
+
+    last_usage = usage;
+    last_time = now;
+}
@@ -1,32 +1,316 @@
 #include "uvc_camera.h"
+#include "alloc_tracker.h"
+#include "rt_profile.h"
+#include "ring_logger.h"
 #include <opencv2/opencv.hpp>
 #include <opencv2/core/utility.hpp>
-#include <iostream>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <linux/videodev2.h>
+#include <atomic>
 
 using namespace cv;
 
-// 内部变量
+// 直通模式JPEG缓冲预留容量（160x120 MJPEG 每帧通常只有几KB）
+#define UVC_JPEG_RESERVE   (64 * 1024)
+
+// 内部变量（启动时按协商的分辨率分配，稳态采集不再重新分配）
 static VideoCapture cap;
 static Mat frame_rgb;
 static Mat frame_gray;
 static uint8_t *gray_image_ptr = nullptr;
 
+// MJPEG 直通：保留摄像头输出的原始JPEG数据
+static bool jpeg_passthrough = false;
+static bool jpeg_available = false;
+static bool raw_jpeg_stream = false;    // 已确认 read() 返回原始JPEG码流
+static std::vector<uint8_t> jpeg_frame; // 原始JPEG码流（长度每帧不同，预留容量避免重新分配）
+
+// 上次协商成功的格式（用于热插拔后直接恢复）
+static std::string last_device;
+static int last_fourcc = 0;
+static int last_width = UVC_WIDTH;
+static int last_height = UVC_HEIGHT;
+static int last_fps = UVC_FPS;
+
+// 输出经过 ring_log：初始化在摄像头线程、重新打开在恢复线程执行，与主线程输出按行排队，不会交错。
+// ring_log 的字符串参数超过 RING_LOG_STR_MAX 会被截断，带路径或 strerror 的一次性消息直接写 stdout/stderr
+
+// 协商格式缓存
+static const char *format_cache_path = UVC_FORMAT_CACHE_PATH;
+static bool format_cached = false;
+static bool verify_cached_format = false;  // 使用缓存打开后，首帧核对格式、分辨率与帧率
+
+struct FormatCache {
+    int fourcc;
+    int width;
+    int height;
+    int fps;
+};
+
+// V4L2 控制项句柄（与 OpenCV 采集句柄独立，供控制线程使用）：
+// 由采集线程在设备打开/关闭时设置，控制线程只读取该值，不访问 cap；
+// ctrl_lock 保证句柄不会在控制线程 ioctl 过程中被关闭
+static std::atomic<int> ctrl_fd(-1);
+static pthread_mutex_t ctrl_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void uvc_camera_set_jpeg_passthrough(bool enable) {
+    jpeg_passthrough = enable;
+}
+
+void uvc_camera_set_format_cache(const char *path) {
+    format_cache_path = path;
+}
+
+bool uvc_camera_format_cached() {
+    return format_cached;
+}
+
+/**
+ * @brief 读取设备名称与总线位置（用于确认缓存对应的是同一个摄像头）
+ */
+static int query_device_identity(const char *device_path, char *card, char *bus, size_t size) {
+    int fd = open(device_path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    struct v4l2_capability cap_info;
+    memset(&cap_info, 0, sizeof(cap_info));
+    int ret = ioctl(fd, VIDIOC_QUERYCAP, &cap_info);
+    close(fd);
+    if (ret < 0) {
+        return -1;
+    }
+    snprintf(card, size, "%.*s", (int)sizeof(cap_info.card), (const char *)cap_info.card);
+    snprintf(bus, size, "%.*s", (int)sizeof(cap_info.bus_info), (const char *)cap_info.bus_info);
+    return 0;
+}
+
+/**
+ * @brief 读取格式缓存（设备、摄像头、请求参数均一致时才有效）
+ * @return 0: 缓存有效, -1: 无缓存或不匹配
+ */
+static int load_format_cache(const char *device_path, const char *card, const char *bus,
+                             struct FormatCache *cache) {
+    FILE *fp = fopen(format_cache_path, "r");
+    if (fp == NULL) {
+        return -1;
+    }
+
+    char line[128];
+    int matched = 0;
+    int request_w = 0, request_h = 0, request_fps = 0;
+    memset(cache, 0, sizeof(*cache));
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (strncmp(line, "device=", 7) == 0) {
+            matched += strcmp(line + 7, device_path) == 0;
+        } else if (strncmp(line, "card=", 5) == 0) {
+            matched += strcmp(line + 5, card) == 0;
+        } else if (strncmp(line, "bus=", 4) == 0) {
+            matched += strcmp(line + 4, bus) == 0;
+        } else {
+            sscanf(line, "request=%dx%d@%d", &request_w, &request_h, &request_fps);
+            sscanf(line, "fourcc=%d", &cache->fourcc);
+            sscanf(line, "size=%dx%d", &cache->width, &cache->height);
+            sscanf(line, "fps=%d", &cache->fps);
+        }
+    }
+    fclose(fp);
+
+    if (matched != 3 || request_w != UVC_WIDTH || request_h != UVC_HEIGHT || request_fps != UVC_FPS ||
+        cache->fourcc == 0 || cache->width <= 0 || cache->height <= 0 || cache->fps <= 0) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief 写入格式缓存（先写临时文件再重命名，断电时不会留下半个文件）
+ */
+static void save_format_cache(const char *device_path, const char *card, const char *bus) {
+    char tmp_path[256];
+    int len = snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", format_cache_path);
+    if (len < 0 || len >= (int)sizeof(tmp_path)) {
+        ring_log_error("Warning: camera format cache path too long, not cached\n");
+        return;
+    }
+    FILE *fp = fopen(tmp_path, "w");
+    if (fp == NULL) {
+        fprintf(stderr, "Warning: cannot write camera format cache %s: %s\n", tmp_path, strerror(errno));
+        return;
+    }
+    fprintf(fp, "# 摄像头协商格式缓存（自动生成，删除后下次启动重新探测）\n");
+    fprintf(fp, "device=%s\ncard=%s\nbus=%s\n", device_path, card, bus);
+    fprintf(fp, "request=%dx%d@%d\n", UVC_WIDTH, UVC_HEIGHT, UVC_FPS);
+    fprintf(fp, "fourcc=%d\nsize=%dx%d\nfps=%d\n", last_fourcc, last_width, last_height, last_fps);
+    bool ok = fflush(fp) == 0 && fsync(fileno(fp)) == 0;
+    fclose(fp);
+    if (!ok || rename(tmp_path, format_cache_path) < 0) {
+        unlink(tmp_path);
+        return;
+    }
+    printf("✓ Camera format cached: %s\n", format_cache_path);
+}
+
+/**
+ * @brief 以已知格式直接打开摄像头（不探测、不回读验证）
+ */
+static bool open_with_format(const std::string &device_path, int fourcc, int width, int height, int fps) {
+    if (fourcc == 0) {
+        fourcc = VideoWriter::fourcc('M', 'J', 'P', 'G');
+    }
+#if CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && \
+    (CV_VERSION_MINOR > 5 || (CV_VERSION_MINOR == 5 && CV_VERSION_REVISION >= 2)))
+    // OpenCV 4.5.2+：打开时一次性传入全部参数，
+    // 避免逐项 set() 时V4L2后端每改一次格式/分辨率就重新初始化一次设备
+    std::vector<int> params = {
+        CAP_PROP_FOURCC, fourcc,
+        CAP_PROP_FRAME_WIDTH, width,
+        CAP_PROP_FRAME_HEIGHT, height,
+        CAP_PROP_FPS, fps,
+    };
+    if (jpeg_passthrough) {
+        params.push_back(CAP_PROP_CONVERT_RGB);
+        params.push_back(0);
+    }
+    try {
+        return cap.open(device_path, CAP_V4L2, params);
+    } catch (const cv::Exception &) {
+        cap.release();
+        return false;
+    }
+#else
+    if (!cap.open(device_path, CAP_V4L2)) {
+        return false;
+    }
+    cap.set(CAP_PROP_FOURCC, fourcc);
+    cap.set(CAP_PROP_FRAME_WIDTH, width);
+    cap.set(CAP_PROP_FRAME_HEIGHT, height);
+    cap.set(CAP_PROP_FPS, fps);
+    if (jpeg_passthrough) {
+        cap.set(CAP_PROP_CONVERT_RGB, 0);
+    }
+    return true;
+#endif
+}
+
+/**
+ * @brief 关闭控制项句柄（采集线程在释放设备前调用），等待进行中的 ioctl 完成
+ */
+static void close_ctrl_fd() {
+    pthread_mutex_lock(&ctrl_lock);
+    int fd = ctrl_fd.exchange(-1);
+    if (fd >= 0) {
+        close(fd);
+    }
+    pthread_mutex_unlock(&ctrl_lock);
+}
+
+/**
+ * @brief 打开控制项句柄并发布给控制线程（采集线程在设备打开成功后调用）
+ */
+static void open_ctrl_fd() {
+    close_ctrl_fd();
+    int fd = open(last_device.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        fprintf(stderr, "打开摄像头控制句柄失败: %s\n", strerror(errno));
+    }
+    ctrl_fd.store(fd);
+}
+
+/**
+ * @brief 按协商结果预先分配帧缓冲并触发缺页（主循环中首次访问不再缺页）
+ */
+static void preallocate_buffers(int width, int height) {
+    frame_gray.create(height, width, CV_8UC1);
+    rt_profile_prefault(frame_gray.data, frame_gray.total() * frame_gray.elemSize());
+    if (!jpeg_passthrough) {
+        frame_rgb.create(height, width, CV_8UC3);
+        rt_profile_prefault(frame_rgb.data, frame_rgb.total() * frame_rgb.elemSize());
+    }
+    // 填0后清空：保留容量，同时触发全部页面的缺页
+    jpeg_frame.assign(UVC_JPEG_RESERVE, 0);
+    jpeg_frame.clear();
+    raw_jpeg_stream = false;
+}
+
+/**
+ * @brief 第三方解码写入预分配的 Mat 后检查缓冲是否沿用：地址、尺寸或类型变化说明被重新分配，计入本程序分配
+ */
+static void check_mat_reused(const Mat &mat, const uint8_t *data, Size size, int type) {
+    if (mat.data != data || mat.size() != size || mat.type() != type) {
+        alloc_tracker_count_own(1);
+    }
+}
+
+/**
+ * @brief 限制单次读帧的等待时间（后端支持 CAP_PROP_READ_TIMEOUT_MSEC 时生效）
+ */
+static void apply_read_timeout() {
+#if CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 6)
+    if (!cap.set(CAP_PROP_READ_TIMEOUT_MSEC, UVC_READ_TIMEOUT_MS)) {
+        ring_log("⚠️  Read timeout not supported by backend, using V4L2 select timeout\n");
+    }
+#endif
+}
+
 int uvc_camera_init(const char *device_path) {
+    // 读超时属性不可用时的退路：V4L2 后端 select() 超时（秒，最小1秒），需在打开设备前设置，不覆盖外部设置
+    setenv("OPENCV_VIDEOIO_V4L_SELECT_TIMEOUT", "1", 0);
+
+    format_cached = false;
+    verify_cached_format = false;
+
+    // 优先使用上次协商的格式：直接打开，跳过探测与回读
+    char card[64] = "";
+    char bus[64] = "";
+    bool identity_known = format_cache_path != NULL &&
+                          query_device_identity(device_path, card, bus, sizeof(card)) == 0;
+    struct FormatCache cache;
+    if (identity_known && load_format_cache(device_path, card, bus, &cache) == 0) {
+        if (open_with_format(device_path, cache.fourcc, cache.width, cache.height, cache.fps)) {
+            last_device = device_path;
+            last_fourcc = cache.fourcc;
+            last_width = cache.width;
+            last_height = cache.height;
+            last_fps = cache.fps;
+            preallocate_buffers(last_width, last_height);
+            apply_read_timeout();
+            open_ctrl_fd();
+            format_cached = true;
+            verify_cached_format = true;
+            printf("Camera opened with cached format: %dx%d @ %d FPS (%s)\n",
+                   last_width, last_height, last_fps, format_cache_path);
+            return 0;
+        }
+        ring_log("⚠️  Cached camera format rejected, probing again\n");
+        cap.release();
+    }
+
     // 打开摄像头设备（参考逐飞LS2K0300开源库优化方案）
     cap.open(device_path, CAP_V4L2);
 
     if (!cap.isOpened()) {
-        std::cerr << "Error: Cannot open camera device: " << device_path << std::endl;
+        fprintf(stderr, "Error: Cannot open camera device: %s\n", device_path);
         return -1;
     }
 
-    std::cout << "Camera opened successfully: " << device_path << std::endl;
+    printf("Camera opened successfully: %s\n", device_path);
 
     // === 高帧率优化方案（参考逐飞LS2K0300开源库）===
 
     // 1. 设置 MJPEG 格式（支持高帧率的关键！）
     cap.set(CAP_PROP_FOURCC, VideoWriter::fourcc('M', 'J', 'P', 'G'));
-    std::cout << "✓ Set MJPEG format for high frame rate support" << std::endl;
+    ring_log("✓ Set MJPEG format for high frame rate support\n");
 
     // 2. 设置分辨率
     cap.set(CAP_PROP_FRAME_WIDTH, UVC_WIDTH);
@@ -35,39 +319,205 @@ int uvc_camera_init(const char *device_path) {
     // 3. 设置帧率（龙邱110fps摄像头）
     cap.set(CAP_PROP_FPS, UVC_FPS);
 
+    // 4. MJPEG 直通：关闭RGB转换，read() 直接返回压缩数据
+    if (jpeg_passthrough) {
+        if (cap.set(CAP_PROP_CONVERT_RGB, 0)) {
+            ring_log("✓ MJPEG passthrough enabled (decode straight to gray)\n");
+        } else {
+            ring_log("⚠️  MJPEG passthrough not supported by backend\n");
+            jpeg_passthrough = false;
+        }
+    }
+
     // ⚠️ 移除以下设置（可能限制性能）：
     // - CAP_PROP_BUFFERSIZE：可能不被V4L2支持
     // - CAP_PROP_AUTO_EXPOSURE / CAP_PROP_EXPOSURE：增加处理开销
+    //   （曝光由 auto_exposure 模块在独立线程通过V4L2控制调节，见 --auto-exposure）
 
     // 验证配置
     int actual_width = cap.get(CAP_PROP_FRAME_WIDTH);
     int actual_height = cap.get(CAP_PROP_FRAME_HEIGHT);
     int actual_fps = cap.get(CAP_PROP_FPS);
 
-    std::cout << "Camera settings: " << actual_width << "x" << actual_height
-              << " @ " << actual_fps << " FPS" << std::endl;
+    // 记录协商结果
+    last_device = device_path;
+    last_fourcc = (int)cap.get(CAP_PROP_FOURCC);
+    last_width = actual_width;
+    last_height = actual_height;
+    last_fps = actual_fps;
+    preallocate_buffers(actual_width, actual_height);
+    apply_read_timeout();
+    open_ctrl_fd();
+
+    ring_log("Camera settings: %dx%d @ %d FPS\n", actual_width, actual_height, actual_fps);
+
+    if (identity_known && last_fourcc != 0 && actual_width > 0 && actual_height > 0 && actual_fps > 0) {
+        save_format_cache(device_path, card, bus);
+    }
 
     if (actual_fps < UVC_FPS) {
-        std::cout << "⚠️  Warning: Requested " << UVC_FPS << " fps, actual "
-                  << actual_fps << " fps" << std::endl;
-        std::cout << "   提示: 请确认使用龙邱110fps摄像头并安装了正确的UVC驱动" << std::endl;
+        ring_log("⚠️  Warning: Requested %d fps, actual %d fps\n", UVC_FPS, actual_fps);
+        ring_log("   提示: 请确认使用龙邱110fps摄像头并安装了正确的UVC驱动\n");
     } else {
-        std::cout << "✅ 摄像头初始化成功: 已达到目标帧率 " << UVC_FPS << " fps" << std::endl;
+        ring_log("✅ 摄像头初始化成功: 已达到目标帧率 %d fps\n", UVC_FPS);
+    }
+
+    return 0;
+}
+
+int uvc_camera_set_control(uint32_t id, int32_t value) {
+    pthread_mutex_lock(&ctrl_lock);
+    int fd = ctrl_fd.load();
+    int ret = -1;
+    if (fd >= 0) {
+        struct v4l2_control ctrl;
+        memset(&ctrl, 0, sizeof(ctrl));
+        ctrl.id = id;
+        ctrl.value = value;
+        ret = ioctl(fd, VIDIOC_S_CTRL, &ctrl);
+        if (ret < 0) {
+            fprintf(stderr, "Warning: VIDIOC_S_CTRL 0x%x = %d failed: %s\n", id, value, strerror(errno));
+        }
+    }
+    pthread_mutex_unlock(&ctrl_lock);
+    return ret < 0 ? -1 : 0;
+}
+
+int uvc_camera_get_control(uint32_t id, int32_t *value) {
+    pthread_mutex_lock(&ctrl_lock);
+    int fd = ctrl_fd.load();
+    int ret = -1;
+    if (fd >= 0) {
+        struct v4l2_control ctrl;
+        memset(&ctrl, 0, sizeof(ctrl));
+        ctrl.id = id;
+        ret = ioctl(fd, VIDIOC_G_CTRL, &ctrl);
+        if (ret == 0 && value != NULL) {
+            *value = ctrl.value;
+        }
+    }
+    pthread_mutex_unlock(&ctrl_lock);
+    return ret < 0 ? -1 : 0;
+}
+
+int uvc_camera_query_control(uint32_t id, int32_t *min, int32_t *max) {
+    pthread_mutex_lock(&ctrl_lock);
+    int fd = ctrl_fd.load();
+    int ret = -1;
+    if (fd >= 0) {
+        struct v4l2_queryctrl query;
+        memset(&query, 0, sizeof(query));
+        query.id = id;
+        ret = ioctl(fd, VIDIOC_QUERYCTRL, &query);
+        if (ret == 0 && (query.flags & V4L2_CTRL_FLAG_DISABLED)) {
+            ret = -1;
+        }
+        if (ret == 0) {
+            if (min != NULL) *min = query.minimum;
+            if (max != NULL) *max = query.maximum;
+        }
+    }
+    pthread_mutex_unlock(&ctrl_lock);
+    return ret < 0 ? -1 : 0;
+}
+
+int uvc_camera_reopen() {
+    if (last_device.empty()) {
+        return -1;
+    }
+
+    close_ctrl_fd();
+    if (cap.isOpened()) {
+        cap.release();
+    }
+    jpeg_available = false;
+
+    if (!open_with_format(last_device, last_fourcc, last_width, last_height, last_fps)) {
+        return -1;
     }
+    preallocate_buffers(last_width, last_height);
+    apply_read_timeout();
+    open_ctrl_fd();
 
+    printf("Camera reopened: %s %dx%d @ %d FPS\n", last_device.c_str(), last_width, last_height, last_fps);
     return 0;
 }
 
+/**
+ * @brief 使用缓存格式打开后的首帧：核对驱动实际协商的 FOURCC、帧率与输出分辨率，
+ *        与缓存不符（例如更换了同型号不同固件的摄像头）时删除缓存，下次启动重新探测
+ */
+static void check_cached_format() {
+    int fourcc = (int)cap.get(CAP_PROP_FOURCC);
+    int fps = (int)cap.get(CAP_PROP_FPS);
+    if (fourcc == last_fourcc && fps == last_fps &&
+        frame_gray.cols == last_width && frame_gray.rows == last_height) {
+        return;
+    }
+    ring_log_error("Warning: cached format %dx%d @ %d FPS (fourcc 0x%x) does not match camera, cache removed\n",
+                   last_width, last_height, last_fps, last_fourcc);
+    ring_log_error("         camera output: %dx%d @ %d FPS (fourcc 0x%x)\n",
+                   frame_gray.cols, frame_gray.rows, fps, fourcc);
+    if (format_cache_path != NULL) {
+        unlink(format_cache_path);
+    }
+}
+
 int wait_image_refresh() {
-    // 读取一帧
-    bool ret = cap.read(frame_rgb);
-    if (!ret || frame_rgb.empty()) {
-        std::cerr << "Error: Failed to read frame from camera" << std::endl;
+    // 读取一帧：JPEG码流直接读入预留容量的缓冲，其余格式读入预分配的Mat
+    bool ret;
+    if (raw_jpeg_stream) {
+        ret = cap.read(jpeg_frame) && !jpeg_frame.empty();
+    } else {
+        // 未关闭RGB转换时 OpenCV 在 read() 内部解码JPEG：解码器内部分配计入 external，
+        // 预分配的 frame_rgb 被重新分配则计入本程序分配
+        const uint8_t *rgb_data = frame_rgb.data;
+        Size rgb_size = frame_rgb.size();
+        int rgb_type = frame_rgb.type();
+        alloc_tracker_external_begin();
+        ret = cap.read(frame_rgb) && !frame_rgb.empty();
+        alloc_tracker_external_end();
+        check_mat_reused(frame_rgb, rgb_data, rgb_size, rgb_type);
+    }
+    if (!ret) {
+        ring_log_error("Error: Failed to read frame from camera\n");
         return -1;
     }
 
-    // 转换为灰度图
-    cvtColor(frame_rgb, frame_gray, COLOR_BGR2GRAY);
+    if (!raw_jpeg_stream && frame_rgb.rows == 1 && frame_rgb.type() == CV_8UC1) {
+        // 首帧确认直通模式为原始JPEG码流，之后改为读入 jpeg_frame
+        raw_jpeg_stream = true;
+        jpeg_frame.assign(frame_rgb.data, frame_rgb.data + frame_rgb.total());
+    }
+
+    if (raw_jpeg_stream) {
+        // 直通模式下为原始JPEG码流：直接解码为灰度图，省去BGR中间结果
+        const uint8_t *gray_data = frame_gray.data;
+        Size gray_size = frame_gray.size();
+        alloc_tracker_external_begin();
+        imdecode(jpeg_frame, IMREAD_GRAYSCALE, &frame_gray);
+        alloc_tracker_external_end();
+        check_mat_reused(frame_gray, gray_data, gray_size, CV_8UC1);
+        jpeg_available = !frame_gray.empty();
+    } else if (frame_rgb.channels() == 2) {
+        // 关闭RGB转换后，非压缩格式返回YUYV原始数据
+        cvtColor(frame_rgb, frame_gray, COLOR_YUV2GRAY_YUYV);
+        jpeg_available = false;
+    } else {
+        // 转换为灰度图
+        cvtColor(frame_rgb, frame_gray, COLOR_BGR2GRAY);
+        jpeg_available = false;
+    }
+
+    if (frame_gray.empty()) {
+        ring_log_error("Error: Failed to decode MJPEG frame\n");
+        return -1;
+    }
+
+    if (verify_cached_format) {
+        verify_cached_format = false;
+        check_cached_format();
+    }
 
     // 更新指针
     gray_image_ptr = frame_gray.data;
@@ -79,10 +529,23 @@ uint8_t* get_gray_image() {
     return gray_image_ptr;
 }
 
+const uint8_t* get_jpeg_image(uint32_t *size) {
+    if (!jpeg_available || jpeg_frame.empty()) {
+        if (size != NULL) *size = 0;
+        return NULL;
+    }
+    if (size != NULL) *size = (uint32_t)jpeg_frame.size();
+    return jpeg_frame.data();
+}
+
 void uvc_camera_close() {
+    close_ctrl_fd();
+
     if (cap.isOpened()) {
         cap.release();
-        std::cout << "Camera closed" << std::endl;
+        ring_log("Camera closed\n");
     }
     gray_image_ptr = nullptr;
+    jpeg_available = false;
+    raw_jpeg_stream = false;
 }